@@ -1,75 +1,692 @@
 #ifndef GENETIC_OPERATIONS_HPP
 #define GENETIC_OPERATIONS_HPP
 
+#include <array>
+#include <cstring>
 #include <fstream>
+#include <numeric>
+#include <sstream>
+#include <type_traits>
 
 #include "openGA.hpp"
+#include "genetic_algorithm/island_model.hpp"
+#include "genetic_algorithm/evaluation_workers.hpp"
+#include "genetic_algorithm/fitness_cache.hpp"
+#include "genetic_algorithm/fitness_store.hpp"
+#include "genetic_algorithm/generation_log.hpp"
+#include "genetic_algorithm/migration_link.hpp"
+#include "genetic_algorithm/surrogate_model.hpp"
 #include "network_model/network.hpp"
+#include "network_model/network_json_reader.hpp"
+#include "network_model/network_json_writer.hpp"
+#include "network_model/simulation_kernel.hpp"
 
-typedef EA::Genetic<Network, double> GA_Type;
+typedef EA::ChromosomeType<Network, double> Chromosome_Type;
 typedef EA::GenerationType<Network, double> Generation_Type;
+typedef EA::ChromosomeType<Network, std::vector<double>> MO_Chromosome_Type; // one objective per node pair
+typedef EA::GenerationType<Network, std::vector<double>> MO_Generation_Type;
 
-void init_genes(Network& network, const std::function<double(void)> &rnd01) {
+template<typename Random01>
+void init_genes(Network& network, const Random01& rnd01) {
     network.init_network_random_instruction_tables(rnd01);
+    network.canonicalize();
     //network.advance_n_time_slots(1000);
 }
 
-double calculate_SO_total_fitness(const GA_Type::thisChromosomeType& X) {
+double calculate_SO_total_fitness(const Chromosome_Type& X) {
     return X.middle_costs;
 }
 
+struct EvaluationSettings {
+    std::size_t samples = 20;
+    std::size_t horizon = 1000; // time slots simulated per sample
+    std::size_t horizon_spread = 500; // plus a random number of time slots up to this
+
+    // Racing: stop sampling offspring whose optimistic cost is still worse than the worst survivor
+    bool racing = true;
+    std::size_t racing_min_samples = 4;
+    double racing_confidence = 3.0; // standard errors subtracted from the running mean
+
+    std::uint64_t key() const { return Hasher128().add(samples).add(horizon).add(horizon_spread).finish().low; }
+};
+
+// Evaluation fidelity ramps from the minimum to `full` over the first generations, or
+// sooner when the population loses diversity (share of distinct genomes). The GA evaluates
+// its members again at every change, see evaluation_fidelity_key().
+struct FidelitySchedule {
+    EvaluationSettings full;
+    std::size_t min_samples = 5;
+    std::size_t min_horizon = 250;
+    int ramp_generations = 30;
+    std::size_t rescored_elites = 10; // re-scored at full fidelity before reporting
+
+    EvaluationSettings at(int generation_step, double diversity) const {
+        double progress = std::max(double(generation_step) / std::max(ramp_generations, 1), 1.0 - diversity);
+        progress = std::min(std::max(progress, 0.0), 1.0);
+
+        EvaluationSettings settings = full;
+        settings.samples = min_samples + static_cast<std::size_t>(std::round(progress * (full.samples - std::min(min_samples, full.samples))));
+        settings.horizon = min_horizon + static_cast<std::size_t>(std::round(progress * (full.horizon - std::min(min_horizon, full.horizon))));
+        settings.samples = std::min(settings.samples, full.samples);
+        settings.horizon = std::min(settings.horizon, full.horizon);
+        return settings;
+    }
+};
+
+struct EvaluationStats {
+    std::atomic<std::uint64_t> samples{0};
+    std::atomic<std::uint64_t> samples_skipped{0};
+    std::atomic<std::uint64_t> stopped_early{0};
+    std::atomic<std::uint64_t> simulation_nanoseconds{0};
+};
+
+FidelitySchedule fidelity_schedule;
+EvaluationSettings evaluation_settings = fidelity_schedule.at(0, 1.0);
+std::mutex evaluation_settings_mtx; // steady-state reports change the fidelity while workers evaluate
+EvaluationStats evaluation_stats;
+FitnessCache<double> fitness_cache;
+FitnessStore fitness_store;
+RidgeSurrogate surrogate_model;
+
+// Per-node swap statistics (period, share of interfaces swapping, share of slots with
+// swaps) for the surrogate; large networks are summarised by their mean and maximum.
+std::vector<double> surrogate_features(const Network& network) {
+    const std::vector<std::unique_ptr<Node>>& nodes = network.nodes();
+    const bool aggregate = nodes.size() > 32;
+
+    std::vector<double> features;
+    features.reserve(aggregate? 7 : 3*nodes.size() + 1);
+    features.push_back(1.0); // bias
+    std::array<double, 3> mean{}, max{};
+    for (const std::unique_ptr<Node>& node : nodes) {
+        const std::vector<TimeSlot>& time_slots = node->time_slots();
+        double n_swaps = 0, busy_slots = 0;
+        for (const TimeSlot& time_slot : time_slots) {
+            n_swaps += time_slot.swap_instructions().size();
+            busy_slots += time_slot.swap_instructions().empty()? 0 : 1;
+        }
+        double n_slots = std::max<std::size_t>(time_slots.size(), 1);
+        std::array<double, 3> node_features{
+            1.0 / n_slots,
+            node->n_interfaces() > 1? 2.0*n_swaps / (n_slots*node->n_interfaces()) : 0.0,
+            busy_slots / n_slots
+        };
+        if (!aggregate) {
+            features.insert(features.end(), node_features.begin(), node_features.end());
+            continue;
+        }
+        for (std::size_t i = 0; i < node_features.size(); ++i) {
+            mean[i] += node_features[i] / nodes.size();
+            max[i] = std::max(max[i], node_features[i]);
+        }
+    }
+    if (aggregate) {
+        features.insert(features.end(), mean.begin(), mean.end());
+        features.insert(features.end(), max.begin(), max.end());
+    }
+    return features;
+}
+
+double surrogate_predict(const Network& network) {
+    return surrogate_model.predict(surrogate_features(network));
+}
+
+// End of a run with --time-limit: racing evaluations still running then stop, and the reports
+// neither re-score the elites nor refit the surrogate
+std::chrono::steady_clock::time_point evaluation_deadline = std::chrono::steady_clock::time_point::max();
+
+void start_evaluation_deadline(double time_limit) {
+    if (time_limit > 0)
+        evaluation_deadline = std::chrono::steady_clock::now()
+            + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(time_limit));
+}
+
+bool evaluation_deadline_passed() {
+    return std::chrono::steady_clock::now() >= evaluation_deadline;
+}
+
+struct SimulationResult {
+    double amount_of_entanglement;
+    std::uint64_t n_samples;
+    std::uint64_t nanoseconds;
+    bool complete; // false when racing or the deadline stopped the simulation before all samples were taken
+};
+
+// Horizons are drawn from a stream keyed by the genome, so a genome always gets the same
+// samples: results do not depend on which thread or process evaluated it, nor on the run.
+// Sampling stops at the deadline, with the mean of the samples taken, at least one.
+SimulationResult simulate_schedule(const RuntimeTopology& topology, const SimulationSchedule& schedule, const EvaluationSettings& settings, const Hash128& genome_hash,
+        double survival_cost, std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max()) {
+    EA::Chronometer timer;
+    timer.tic();
+
+    EA::Philox rgen(genome_hash.low, genome_hash.high ^ settings.key());
+    double mean = 0, m2 = 0;
+    std::size_t n_samples = 0;
+    bool complete = true;
+    with_simulation_kernel(topology, schedule, [&](auto& kernel) {
+        while (n_samples < settings.samples) {
+            if (n_samples > 0 && deadline != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() >= deadline) {
+                complete = false;
+                break;
+            }
+            kernel.advance_n_time_slots(settings.horizon + rgen() % (settings.horizon_spread + 1));
+            double cost = -kernel.amount_entanglement();
+            kernel.reset();
+
+            // Welford running mean and variance
+            ++n_samples;
+            double delta = cost - mean;
+            mean += delta / n_samples;
+            m2 += delta * (cost - mean);
+
+            if (settings.racing && n_samples >= settings.racing_min_samples && n_samples < settings.samples) {
+                double optimistic_cost = mean - settings.racing_confidence * std::sqrt(m2 / (n_samples - 1) / n_samples);
+                if (optimistic_cost > survival_cost) {
+                    mean = optimistic_cost;
+                    complete = false;
+                    break;
+                }
+            }
+        }
+    });
+    return SimulationResult{mean, n_samples, static_cast<std::uint64_t>(timer.toc() * 1e9), complete};
+}
+
+// Evaluation request sent to the worker processes as raw bytes
+struct WorkerRequest {
+    Hash128 genome_hash;
+    EvaluationSettings settings;
+    double survival_cost;
+    std::chrono::steady_clock::time_point deadline;
+};
+static_assert(std::is_trivially_copyable<WorkerRequest>::value && sizeof(WorkerRequest) <= EvaluationWorkers::max_request_bytes,
+    "WorkerRequest must fit an evaluation worker slot");
+static_assert(std::is_trivially_copyable<SimulationResult>::value && sizeof(SimulationResult) <= EvaluationWorkers::max_response_bytes,
+    "SimulationResult must fit an evaluation worker slot");
+
+EvaluationWorkers evaluation_workers;
+std::unique_ptr<RuntimeTopology> worker_topology; // shared by every genome, held read-only by the workers
+
+// Forks the worker processes, which must happen before the optimization starts any thread.
+// Genomes are sent to them as flattened instruction tables (SimulationSchedule::encode).
+void start_evaluation_workers(std::size_t n_workers, const Network& network) {
+    worker_topology.reset(new RuntimeTopology(network));
+    evaluation_workers.start(n_workers, 1 << 16, [](const void* request_bytes, const std::uint32_t* genome, std::size_t n_words, void* response) {
+        WorkerRequest request;
+        std::memcpy(&request, request_bytes, sizeof(request));
+        SimulationResult result = simulate_schedule(*worker_topology, SimulationSchedule(genome, n_words), request.settings, request.genome_hash, request.survival_cost, request.deadline);
+        std::memcpy(response, &result, sizeof(result));
+    });
+}
+
+// Returns false when racing or the deadline stopped the simulation before all samples were taken.
+bool simulate_amount_of_entanglement(const Network& network, const EvaluationSettings& settings, const Hash128& genome_hash, double& amount_of_entanglement,
+        double survival_cost, std::chrono::steady_clock::time_point deadline) {
+    SimulationResult result;
+    bool dispatched = false;
+    if (evaluation_workers.running()) {
+        std::vector<std::uint32_t> genome;
+        SimulationSchedule(network, *worker_topology).encode(genome);
+        WorkerRequest request{genome_hash, settings, survival_cost, deadline};
+        dispatched = evaluation_workers.evaluate(&request, sizeof(request), genome, &result, sizeof(result));
+    }
+    if (!dispatched) {
+        RuntimeTopology topology(network);
+        result = simulate_schedule(topology, SimulationSchedule(network, topology), settings, genome_hash, survival_cost, deadline);
+    }
+    amount_of_entanglement = result.amount_of_entanglement;
+
+    evaluation_stats.samples += result.n_samples;
+    evaluation_stats.samples_skipped += settings.samples - result.n_samples;
+    if (!result.complete)
+        ++evaluation_stats.stopped_early;
+    evaluation_stats.simulation_nanoseconds += result.nanoseconds;
+    return result.complete;
+}
+
+// Evaluations of the current generation, only remembered by publish_evaluations() once it ends.
+// A genome evaluated twice in a generation (a duplicate offspring, or an offspring raced while
+// it also audits the surrogate) is then simulated both times, instead of hitting the cache or
+// not depending on which thread finished first, and the trajectory of a seeded run does not
+// depend on the number of threads or on the timing of the evaluation workers.
+struct PendingEvaluation {
+    Hash128 cache_key;
+    Hash128 genome_hash;
+    std::uint64_t settings_key;
+    double cost;
+    bool stored; // found in the fitness store
+};
+std::vector<PendingEvaluation> pending_evaluations;
+std::mutex pending_evaluations_mtx;
+
+void publish_evaluations() {
+    std::vector<PendingEvaluation> pending;
+    {
+        std::lock_guard<std::mutex> lock(pending_evaluations_mtx);
+        pending.swap(pending_evaluations);
+    }
+    std::sort(pending.begin(), pending.end(), [](const PendingEvaluation& a, const PendingEvaluation& b) {
+        if (a.cache_key.high != b.cache_key.high) return a.cache_key.high < b.cache_key.high;
+        if (a.cache_key.low != b.cache_key.low) return a.cache_key.low < b.cache_key.low;
+        return a.stored > b.stored;
+    });
+    pending.erase(std::unique(pending.begin(), pending.end(), [](const PendingEvaluation& a, const PendingEvaluation& b) {
+        return a.cache_key == b.cache_key;
+    }), pending.end());
+    for (const PendingEvaluation& evaluation : pending) {
+        fitness_cache.insert(evaluation.cache_key, evaluation.cost);
+        if (!evaluation.stored)
+            fitness_store.append(evaluation.genome_hash, evaluation.settings_key, evaluation.cost);
+    }
+    // Once a generation: lookups of the next one see what other runs stored meanwhile
+    fitness_store.refresh();
+}
+
+bool evaluate(const Network& network, const EvaluationSettings& settings, double& amount_of_entanglement, double survival_cost,
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max()) {
+    Hash128 genome_hash = network.genome_hash();
+    Hash128 cache_key = Hasher128().add(genome_hash.low).add(genome_hash.high).add(settings.key()).finish();
+    if (fitness_cache.lookup(cache_key, amount_of_entanglement))
+        return true;
+    if (fitness_store.lookup(genome_hash, settings.key(), amount_of_entanglement)) {
+        std::lock_guard<std::mutex> lock(pending_evaluations_mtx);
+        pending_evaluations.push_back(PendingEvaluation{cache_key, genome_hash, settings.key(), amount_of_entanglement, true});
+        return true;
+    }
+
+    // Only complete evaluations are remembered, the racing bound depends on the population
+    if (simulate_amount_of_entanglement(network, settings, genome_hash, amount_of_entanglement, survival_cost, deadline)) {
+        {
+            std::lock_guard<std::mutex> lock(pending_evaluations_mtx);
+            pending_evaluations.push_back(PendingEvaluation{cache_key, genome_hash, settings.key(), amount_of_entanglement, false});
+        }
+        surrogate_model.observe(genome_hash.low, surrogate_features(network), amount_of_entanglement);
+    }
+    return true; // genes are accepted
+}
+
+EvaluationSettings current_evaluation_settings() {
+    std::lock_guard<std::mutex> lock(evaluation_settings_mtx);
+    return evaluation_settings;
+}
+
+// Changes with the fidelity, so that the GA evaluates its members again when it does
+std::uint64_t evaluation_fidelity_key() {
+    return current_evaluation_settings().key();
+}
+
+bool eval_solution_racing(const Network& network, double& amount_of_entanglement, double survival_cost) {
+    evaluate(network, current_evaluation_settings(), amount_of_entanglement, survival_cost, evaluation_deadline);
+    return !evaluation_deadline_passed(); // the offspring of an evaluation the deadline cut short is dropped
+}
+
+// An evaluation the deadline cut short keeps the mean of its samples, so the initial population
+// has a cost for every individual it was stopped with.
 bool eval_solution(const Network& network, double& amount_of_entanglement) {
-    double mean_amount_of_entanglement = 0;
-    std::random_device rseed;
-    std::mt19937 rgen(rseed()); // mersenne_twister
-    std::uniform_int_distribution<int> idist(0,500);
-    for (std::size_t variation = 0; variation < 20; ++variation) {
-        network.advance_n_time_slots(1000 +  idist(rgen));
-        mean_amount_of_entanglement -= network.amount_entanglement();
-        network.reset();
-    }
-	amount_of_entanglement = mean_amount_of_entanglement / 20;
+    return evaluate(network, current_evaluation_settings(), amount_of_entanglement, std::numeric_limits<double>::infinity(), evaluation_deadline);
+}
+
+// Mean amount of entanglement of every pair over the samples simulate_schedule would draw, without racing.
+// Like simulate_schedule, sampling stops at the deadline after the first sample.
+std::vector<double> simulate_pair_entanglement(const RuntimeTopology& topology, const SimulationSchedule& schedule, const EvaluationSettings& settings, const Hash128& genome_hash,
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max()) {
+    EA::Philox rgen(genome_hash.low, genome_hash.high ^ settings.key());
+    std::vector<double> mean(topology.n_pairs(), 0.0);
+    with_simulation_kernel(topology, schedule, [&](auto& kernel) {
+        for (std::size_t n_samples = 1; n_samples <= settings.samples; ++n_samples) {
+            if (n_samples > 1 && deadline != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() >= deadline)
+                break;
+            kernel.advance_n_time_slots(settings.horizon + rgen() % (settings.horizon_spread + 1));
+            for (std::size_t pair = 0; pair < mean.size(); ++pair)
+                mean[pair] += (kernel.pair_amount_entanglement(pair) - mean[pair]) / n_samples;
+            kernel.reset();
+        }
+    });
+    return mean;
+}
+
+// Multi-objective runs keep the entanglement of every pair apart, in the order of Network::pairs().
+// They are simulated in-process and not cached, the cache and the workers hold a single cost.
+bool eval_solution_MO(const Network& network, std::vector<double>& pair_entanglement) {
+    RuntimeTopology topology(network);
+    pair_entanglement = simulate_pair_entanglement(topology, SimulationSchedule(network, topology), current_evaluation_settings(), network.genome_hash(), evaluation_deadline);
     return true; // genes are accepted
 }
 
-Network mutate(const Network& base_network, const std::function<double(void)>& rnd01, double shrink_scale) {
-    Network new_network(base_network.to_json());
-    new_network.mutate(rnd01);
+std::vector<double> calculate_MO_objectives(const MO_Chromosome_Type& X) {
+    std::vector<double> objectives(X.middle_costs.size());
+    for (std::size_t pair = 0; pair < objectives.size(); ++pair)
+        objectives[pair] = -X.middle_costs[pair]; // entanglement is maximised
+    return objectives;
+}
+
+double full_fidelity_cost(const Network& network) {
+    double amount_of_entanglement;
+    evaluate(network, fidelity_schedule.full, amount_of_entanglement, std::numeric_limits<double>::infinity());
+    return amount_of_entanglement;
+}
+
+// Index of the best of the leading elites once they are all re-scored at full fidelity
+int best_full_fidelity_elite(const Generation_Type& generation, double& cost) {
+    int best_index = generation.best_chromosome_index;
+    cost = std::numeric_limits<double>::infinity();
+    std::size_t n_elites = std::min(fidelity_schedule.rescored_elites, generation.sorted_indices.size());
+    for (std::size_t i = 0; i < n_elites; ++i) {
+        int index = generation.sorted_indices[i];
+        double elite_cost = full_fidelity_cost(generation.chromosomes[index].genes);
+        if (elite_cost < cost) {
+            cost = elite_cost;
+            best_index = index;
+        }
+    }
+    if (n_elites == 0)
+        cost = full_fidelity_cost(generation.chromosomes[best_index].genes);
+    return best_index;
+}
+
+template<typename Generation>
+double genome_diversity(const Generation& generation) {
+    if (generation.chromosomes.empty()) return 1.0;
+    std::vector<Hash128> hashes;
+    hashes.reserve(generation.chromosomes.size());
+    for (const auto& X : generation.chromosomes)
+        hashes.push_back(X.genes.genome_hash());
+    std::sort(hashes.begin(), hashes.end(), [](const Hash128& a, const Hash128& b) {
+        return a.high < b.high || (a.high == b.high && a.low < b.low);
+    });
+    std::size_t distinct = std::unique(hashes.begin(), hashes.end()) - hashes.begin();
+    return double(distinct) / generation.chromosomes.size();
+}
+
+template<typename Random01>
+Network mutate(const Network& base_network, const Random01& rnd01, double shrink_scale) {
+    Network new_network(base_network);
+    // A mutation can land on a schedule equivalent to its parent; try again a few times
+    Hash128 base_hash = base_network.genome_hash();
+    for (int attempt = 0; attempt < 4; ++attempt) {
+        new_network.mutate(rnd01);
+        new_network.canonicalize();
+        if (new_network.genome_hash() != base_hash)
+            break;
+    }
     //new_network.advance_n_time_slots(1000);
     
     return new_network;
 }
 
-Network crossover(const Network& network1, const Network& network2, const std::function<double(void)>& rnd01) {
-    using json = nlohmann::json;
-
-    json network_config1 = network1.to_json();
-    json network_config2 = network2.to_json();
+// Share of the crossovers that mix time slots instead of whole instruction tables
+double time_slot_crossover_rate = 0.0;
 
-    for (auto& element : network_config1["nodes"].items())
+// Every node takes its whole instruction table from either parent
+template<typename Random01>
+Network node_crossover(const Network& network1, const Network& network2, const Random01& rnd01) {
+    Network new_network(network1);
+    for (std::size_t node = 0; node < new_network.nodes().size(); ++node)
         if (rnd01() > 0.5)
-            network_config1["nodes"][element.key()]["time_slots"] = network_config2["nodes"][element.key()]["time_slots"];
-    Network new_network(network_config1);
-    //new_network.advance_n_time_slots(1000);
+            new_network.copy_instruction_table(node, network2);
+    new_network.canonicalize();
+    return new_network;
+}
 
+// Every node keeps the table length of the first parent and takes each slot from either parent,
+// the second parent's table repeating past its end as it does when the schedule runs
+template<typename Random01>
+Network time_slot_crossover(const Network& network1, const Network& network2, const Random01& rnd01) {
+    Network new_network(network1);
+    for (std::size_t node = 0; node < new_network.nodes().size(); ++node) {
+        std::size_t n_slots2 = network2.nodes()[node]->time_slots().size();
+        if (n_slots2 == 0)
+            continue;
+        for (std::size_t slot = 0; slot < new_network.nodes()[node]->time_slots().size(); ++slot)
+            if (rnd01() > 0.5)
+                new_network.copy_time_slot(node, slot, network2, slot % n_slots2);
+    }
+    new_network.canonicalize();
     return new_network;
 }
 
+template<typename Random01>
+Network crossover(const Network& network1, const Network& network2, const Random01& rnd01) {
+    if (time_slot_crossover_rate > 0 && rnd01() < time_slot_crossover_rate)
+        return time_slot_crossover(network1, network2, rnd01);
+    return node_crossover(network1, network2, rnd01);
+}
+
+// Operators of the optimizers bound at compile time, so that the random draws of initialization,
+// mutation and crossover are inlined; evaluate is the evaluation of the cost type
+template<typename MiddleCostType, bool (*evaluate)(const Network&, MiddleCostType&)>
+struct NetworkOperators {
+    struct InitGenes {
+        template<typename Random01>
+        void operator()(Network& network, const Random01& rnd01) const { ::init_genes(network, rnd01); }
+    } init_genes;
+
+    struct EvalSolution {
+        bool operator()(const Network& network, MiddleCostType& costs) const { return evaluate(network, costs); }
+    } eval_solution;
+
+    struct Mutate {
+        template<typename Random01>
+        Network operator()(const Network& network, const Random01& rnd01, double shrink_scale) const { return ::mutate(network, rnd01, shrink_scale); }
+    } mutate;
+
+    struct Crossover {
+        template<typename Random01>
+        Network operator()(const Network& network1, const Network& network2, const Random01& rnd01) const { return ::crossover(network1, network2, rnd01); }
+    } crossover;
+};
+
+typedef EA::Genetic<Network, double, NetworkOperators<double, eval_solution>> GA_Type;
+typedef EA::IslandModel<Network, double, NetworkOperators<double, eval_solution>> Island_Type;
+typedef EA::Genetic<Network, std::vector<double>, NetworkOperators<std::vector<double>, eval_solution_MO>> MO_GA_Type;
+
 std::ofstream output_file;
+GenerationLog generation_log;
+
+// Only the instruction tables of the best genome are copied on the optimizer's thread,
+// the log is written in the background
+void log_generation(int generation_number, double best, double average, double exe_time, const Network& best_genes) {
+    GenerationLog::Snapshot snapshot;
+    snapshot.generation = generation_number;
+    snapshot.best = best;
+    snapshot.average = average;
+    snapshot.exe_time = exe_time;
+    best_genes.encode_instruction_tables(snapshot.genome);
+    generation_log.report(std::move(snapshot));
+}
+
+// Evaluation time racing saved since the previous report, estimated from the mean cost of a sample
+void print_racing_stats() {
+    std::uint64_t samples = evaluation_stats.samples.exchange(0);
+    std::uint64_t samples_skipped = evaluation_stats.samples_skipped.exchange(0);
+    std::uint64_t stopped_early = evaluation_stats.stopped_early.exchange(0);
+    double simulation_time = evaluation_stats.simulation_nanoseconds.exchange(0) * 1e-9;
+    if (samples_skipped > 0)
+        std::cout
+            <<", Racing_stopped="<<stopped_early
+            <<", Racing_saved="<<simulation_time / samples * samples_skipped;
+}
+
+// Remembers the evaluations of the generation, refits the surrogate and sets the fidelity of the
+// next one, unless time is up and no generation follows
+void advance_evaluation_settings(int generation_number, double diversity) {
+    publish_evaluations();
+    if (evaluation_deadline_passed())
+        return;
+    surrogate_model.fit();
+
+    EvaluationSettings next_settings = fidelity_schedule.at(generation_number + 1, diversity);
+    std::lock_guard<std::mutex> lock(evaluation_settings_mtx);
+    evaluation_settings = next_settings;
+}
+
+// Tasks per second of a busy worker thread on each NUMA node, only known when threads are pinned
+void print_node_throughput(const std::vector<double>& node_throughput) {
+    if (node_throughput.empty())
+        return;
+    std::cout<<", Node_throughput=";
+    for (std::size_t node = 0; node < node_throughput.size(); ++node)
+        std::cout<<(node > 0? "/" : "")<<node_throughput[node];
+}
 
 void SO_report_generation(int generation_number, const Generation_Type& last_generation, const Network& best_genes) {
+    (void) best_genes; // the reported individual is the best elite at full fidelity, until time is up
+    bool time_up = evaluation_deadline_passed();
+    double best_full_cost = last_generation.best_total_cost;
+    int best_index = time_up? last_generation.best_chromosome_index : best_full_fidelity_elite(last_generation, best_full_cost);
+
 	std::cout
 		<<"Generation ["<<generation_number<<"], "
-		<<"Best="<<last_generation.best_total_cost<<", "
+		<<"Best="<<last_generation.best_total_cost<<", ";
+    if (!time_up)
+        std::cout<<"Best_full="<<best_full_cost<<", ";
+    std::cout
 		<<"Average="<<last_generation.average_cost<<", "
-        <<"Exe_time="<<last_generation.exe_time << "\n";
+        <<"Exe_time="<<last_generation.exe_time<<", "
+        <<"Samples="<<evaluation_settings.samples<<"x"<<evaluation_settings.horizon<<", "
+        <<"Idle_wakeups="<<last_generation.idle_wakeups<<", "
+        <<"Steals="<<last_generation.steals;
+    if (last_generation.thread_startup_time > 0)
+        std::cout<<", Thread_startup="<<last_generation.thread_startup_time;
+    print_node_throughput(last_generation.node_throughput);
+    print_racing_stats();
+    if (last_generation.surrogate_audits > 0)
+        std::cout
+            <<", Surrogate_hit_rate="<<double(last_generation.surrogate_hits) / last_generation.surrogate_audits;
+    std::cout << "\n";
 
     //best_genes.print();
 
-	output_file
-		<<generation_number<<"\t";
-		output_file << best_genes.to_json().dump();
+    log_generation(generation_number, best_full_cost, last_generation.average_cost, last_generation.exe_time, last_generation.chromosomes[best_index].genes);
+
+    advance_evaluation_settings(generation_number, genome_diversity(last_generation));
+}
+
+// One line for the whole model, with the best island re-scored as SO_report_generation does,
+// then one line per island. The fidelity follows the mean diversity of the islands.
+void islands_report_generation(int generation_number, const Island_Type& islands) {
+    const Generation_Type& best_generation = islands.island(islands.best_island()).last_generation;
+    bool time_up = evaluation_deadline_passed();
+    double best_full_cost = best_generation.best_total_cost;
+    int best_index = time_up? best_generation.best_chromosome_index : best_full_fidelity_elite(best_generation, best_full_cost);
+
+    double average = 0, exe_time = 0, diversity = 0;
+    unsigned int surrogate_audits = 0, surrogate_hits = 0;
+    for (unsigned int i = 0; i < islands.size(); ++i) {
+        const Generation_Type& generation = islands.island(i).last_generation;
+        average += generation.average_cost / islands.size();
+        exe_time = std::max(exe_time, generation.exe_time);
+        diversity += genome_diversity(generation) / islands.size();
+        surrogate_audits += generation.surrogate_audits;
+        surrogate_hits += generation.surrogate_hits;
+    }
+
+    std::cout
+        <<"Generation ["<<generation_number<<"], "
+        <<"Best="<<best_generation.best_total_cost<<", ";
+    if (!time_up)
+        std::cout<<"Best_full="<<best_full_cost<<", ";
+    std::cout
+        <<"Average="<<average<<", "
+        <<"Exe_time="<<exe_time<<", "
+        <<"Samples="<<evaluation_settings.samples<<"x"<<evaluation_settings.horizon;
+    print_racing_stats();
+    if (surrogate_audits > 0)
+        std::cout<<", Surrogate_hit_rate="<<double(surrogate_hits) / surrogate_audits;
+    std::cout << "\n";
+    for (unsigned int i = 0; i < islands.size(); ++i) {
+        const Island_Type::IslandStats& stats = islands.stats(i);
+        std::cout
+            <<"  Island ["<<i<<"], "
+            <<"Best="<<stats.best_total_cost<<", "
+            <<"Average="<<stats.average_cost<<", "
+            <<"Exe_time="<<stats.exe_time<<", "
+            <<"Immigrants="<<stats.immigrants;
+        print_node_throughput(islands.island(i).last_generation.node_throughput);
+        if (stats.stop != EA::StopReason::Undefined)
+            std::cout<<", Stopped="<<islands.island(i).stop_reason_to_string(stats.stop);
+        std::cout << "\n";
+    }
+
+    log_generation(generation_number, best_full_cost, average, exe_time, best_generation.chromosomes[best_index].genes);
+
+    advance_evaluation_settings(generation_number, diversity);
+}
+
+// Among the Pareto front: the best total entanglement and the best entanglement of the least served pair
+void MO_report_generation(int generation_number, const MO_Generation_Type& last_generation, const std::vector<unsigned int>& pareto_front) {
+    double best_total = -std::numeric_limits<double>::infinity(), best_min_pair = best_total;
+    unsigned int best_index = pareto_front.empty()? 0 : pareto_front[0];
+    for (unsigned int index : pareto_front) {
+        const std::vector<double>& pair_entanglement = last_generation.chromosomes[index].middle_costs;
+        double total = std::accumulate(pair_entanglement.begin(), pair_entanglement.end(), 0.0);
+        if (total > best_total) {
+            best_total = total;
+            best_index = index;
+        }
+        if (!pair_entanglement.empty())
+            best_min_pair = std::max(best_min_pair, *std::min_element(pair_entanglement.begin(), pair_entanglement.end()));
+    }
+
+    std::cout
+        <<"Generation ["<<generation_number<<"], "
+        <<"Pareto_front="<<pareto_front.size()<<", "
+        <<"Fronts="<<last_generation.fronts.size()<<", "
+        <<"Best_total="<<best_total<<", "
+        <<"Best_min_pair="<<best_min_pair<<", "
+        <<"Exe_time="<<last_generation.exe_time<<", "
+        <<"Samples="<<evaluation_settings.samples<<"x"<<evaluation_settings.horizon;
+    print_node_throughput(last_generation.node_throughput);
+    std::cout << "\n";
+
+    // Logged as costs, the negated total entanglement, like the single objective runs
+    double average_cost = 0;
+    for (const MO_Generation_Type::thisChromosomeType& X : last_generation.chromosomes)
+        average_cost -= std::accumulate(X.middle_costs.begin(), X.middle_costs.end(), 0.0) / last_generation.chromosomes.size();
+    log_generation(generation_number, -best_total, average_cost, last_generation.exe_time, last_generation.chromosomes[best_index].genes);
+
+    advance_evaluation_settings(generation_number, genome_diversity(last_generation));
+}
+
+// Sends the best individuals of this optimizer to its peers, and lets the individuals received
+// since the last exchange take the places of the worst ones. Their costs are not comparable when
+// the peers are at another fidelity, so they are evaluated again here.
+void exchange_migrants(GA_Type& ga, MigrationLink& link, unsigned int n_migrants) {
+    MigrationLink::Message message;
+    message.sender = link.address();
+    message.best_cost = ga.last_generation.best_total_cost;
+    NetworkJsonWriter json_writer;
+    for (const GA_Type::thisChromosomeType& X : ga.emigrants(n_migrants))
+        message.migrants.emplace_back(X.total_cost, json_writer.write(X.genes));
+    std::size_t reached = link.broadcast(message);
+
+    std::vector<GA_Type::thisChromosomeType> arrivals;
+    double best_remote_cost = std::numeric_limits<double>::infinity();
+    for (const MigrationLink::Message& received : link.receive()) {
+        best_remote_cost = std::min(best_remote_cost, received.best_cost);
+        for (const std::pair<double, std::string>& migrant : received.migrants) {
+            try {
+                // Read by the validating streaming parser, and only kept for this topology
+                std::istringstream genome_json(migrant.second);
+                GA_Type::thisChromosomeType X{Network(NetworkJsonReader().read(genome_json)), 0.0, 0.0, {}};
+                if (RuntimeTopology(X.genes).hash().low != link.tag())
+                    throw "Migrant of another topology";
+                X.genes.canonicalize();
+                eval_solution(X.genes, X.middle_costs);
+                X.total_cost = calculate_SO_total_fitness(X);
+                arrivals.push_back(std::move(X));
+            } catch (...) {
+                std::cout << "Dropped a malformed migrant from " << received.sender << "\n";
+            }
+        }
+    }
 
+    std::cout << "Migration: sent to " << reached << "/" << link.n_peers() << " peers, received " << arrivals.size() << " migrants";
+    if (std::isfinite(best_remote_cost))
+        std::cout << ", Best_remote=" << best_remote_cost;
+    std::cout << "\n";
+    ga.immigrate(std::move(arrivals));
 }
 
-#endif //GENETIC_OPERATIONS_HPP
\ No newline at end of file
+#endif //GENETIC_OPERATIONS_HPP
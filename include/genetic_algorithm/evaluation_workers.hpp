@@ -0,0 +1,74 @@
+#ifndef EVALUATION_WORKERS_HPP
+#define EVALUATION_WORKERS_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include <sys/types.h>
+
+// Evaluations run by forked worker processes.
+//
+// Requests and responses go through a ring of slots in an anonymous shared mapping
+// created before the fork, synchronised by process-shared semaphores: a caller fills a
+// free slot with a fixed-size request and the words of a compact genome, queues its
+// index and waits on the slot, while an idle worker takes the index, runs the evaluator
+// and posts the slot back with its response. Any number of threads may call evaluate().
+// A caller that waits too long checks whether the worker holding its slot has died: the
+// slot is then reclaimed and the request evaluated by the caller, and the remaining
+// workers carry on.
+//
+// The workers inherit the memory of the parent at start(), so it has to be called
+// before the process creates any thread.
+class EvaluationWorkers {
+public:
+    static constexpr std::size_t max_request_bytes = 128;
+    static constexpr std::size_t max_response_bytes = 64;
+
+    // Runs in a worker: request bytes and genome words in, response bytes out
+    typedef std::function<void(const void* request, const std::uint32_t* genome, std::size_t n_words, void* response)> Evaluator;
+
+    EvaluationWorkers() = default;
+    EvaluationWorkers(const EvaluationWorkers&) = delete;
+    EvaluationWorkers& operator=(const EvaluationWorkers&) = delete;
+    ~EvaluationWorkers();
+
+    void start(std::size_t n_workers, std::size_t max_genome_words, const Evaluator& evaluator);
+    void stop();
+    bool running() const { return _n_workers.load(std::memory_order_relaxed) > 0; }
+    std::size_t n_workers() const { return _n_workers.load(std::memory_order_relaxed); }
+
+    // False when the request cannot be sent (no workers, or a genome longer than the
+    // slots) or its worker died, in which case the caller evaluates it itself.
+    bool evaluate(const void* request, std::size_t request_bytes, const std::vector<std::uint32_t>& genome, void* response, std::size_t response_bytes);
+
+private:
+    struct Shared;
+    struct Slot;
+
+    // Workers not known to have exited
+    std::mutex _workers_mtx;
+    std::vector<pid_t> _workers;
+    std::atomic<std::size_t> _n_workers{0};
+    void* _mapping = nullptr;
+    std::size_t _mapping_bytes = 0;
+    std::size_t _n_slots = 0;
+    std::size_t _slot_bytes = 0;
+    std::size_t _max_genome_words = 0;
+
+    // Free slots are only handed out by this process
+    std::mutex _free_mtx;
+    std::condition_variable _free_cv;
+    std::vector<std::uint32_t> _free_slots;
+
+    Shared& shared() const;
+    Slot& slot(std::size_t index) const;
+    void enqueue(std::uint32_t index);
+    bool worker_exited(pid_t worker);
+    void worker_loop(const Evaluator& evaluator);
+};
+
+#endif //EVALUATION_WORKERS_HPP
@@ -0,0 +1,59 @@
+#ifndef FITNESS_CACHE_HPP
+#define FITNESS_CACHE_HPP
+
+#include "network_model/genome_hash.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+// Thread-safe memoization of evaluated genomes. Keys are spread over independently
+// locked stripes so concurrent evaluations rarely wait on each other.
+template<typename CostType, std::size_t N_stripes = 64>
+class FitnessCache {
+public:
+    FitnessCache(std::size_t max_entries = 1 << 20): _max_entries_per_stripe(max_entries/N_stripes + 1) {}
+
+    bool lookup(const Hash128& genome_hash, CostType& cost) {
+        Stripe& stripe = stripe_for(genome_hash);
+        {
+            std::lock_guard<std::mutex> lock(stripe.mtx);
+            auto it = stripe.entries.find(genome_hash);
+            if (it != stripe.entries.end()) {
+                cost = it->second;
+                _hits.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        _misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    void insert(const Hash128& genome_hash, const CostType& cost) {
+        Stripe& stripe = stripe_for(genome_hash);
+        std::lock_guard<std::mutex> lock(stripe.mtx);
+        if (stripe.entries.size() >= _max_entries_per_stripe)
+            stripe.entries.clear();
+        stripe.entries.emplace(genome_hash, cost);
+    }
+
+    std::uint64_t hits() const { return _hits.load(std::memory_order_relaxed); }
+    std::uint64_t misses() const { return _misses.load(std::memory_order_relaxed); }
+
+private:
+    struct alignas(64) Stripe {
+        std::mutex mtx;
+        std::unordered_map<Hash128, CostType, Hash128Hasher> entries;
+    };
+
+    std::size_t _max_entries_per_stripe;
+    std::array<Stripe, N_stripes> _stripes;
+    std::atomic<std::uint64_t> _hits{0};
+    std::atomic<std::uint64_t> _misses{0};
+
+    Stripe& stripe_for(const Hash128& genome_hash) { return _stripes[genome_hash.high % N_stripes]; }
+};
+
+#endif //FITNESS_CACHE_HPP
@@ -0,0 +1,63 @@
+#ifndef FITNESS_STORE_HPP
+#define FITNESS_STORE_HPP
+
+#include "network_model/genome_hash.hpp"
+
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+// Append-only file of evaluated genomes shared between optimization runs.
+//
+// Every record is keyed by (topology hash, genome hash, evaluation parameters) and
+// carries a checksum, so records torn by a crashed or concurrent writer are ignored.
+// On open, and on refresh() once another process has grown the file, the file is mmapped
+// and the records of this topology are loaded into an in-memory index. Lookups only read
+// the index, so the records of other runs are found from the next refresh().
+class FitnessStore {
+public:
+    FitnessStore() = default;
+    FitnessStore(const FitnessStore&) = delete;
+    FitnessStore& operator=(const FitnessStore&) = delete;
+    ~FitnessStore();
+
+    void open(const std::string& path, const Hash128& topology_hash);
+    void close();
+    bool is_open() const { return _fd >= 0; }
+
+    bool lookup(const Hash128& genome_hash, std::uint64_t evaluation_parameters, double& cost);
+    void append(const Hash128& genome_hash, std::uint64_t evaluation_parameters, double cost);
+    // Loads the records other processes appended since the last scan
+    void refresh();
+
+    std::size_t loaded_records() const { return _loaded_records; }
+    std::size_t appended_records() const { return _appended_records; }
+
+private:
+    struct Record {
+        Hash128 topology_hash;
+        Hash128 genome_hash;
+        std::uint64_t evaluation_parameters;
+        double cost;
+        std::uint64_t checksum;
+        std::uint64_t reserved;
+    };
+    static_assert(sizeof(Record) == 64, "FitnessStore records must be 64 bytes");
+
+    int _fd = -1;
+    Hash128 _topology_hash;
+    std::size_t _scanned_bytes = 0;
+    std::size_t _loaded_records = 0;
+    std::size_t _appended_records = 0;
+    std::size_t _unscanned_own_bytes = 0;
+    std::shared_mutex _mtx;
+    std::unordered_map<Hash128, double, Hash128Hasher> _index;
+
+    static Hash128 index_key(const Hash128& genome_hash, std::uint64_t evaluation_parameters);
+    static std::uint64_t checksum(const Record& record);
+
+    void load_new_records();
+};
+
+#endif //FITNESS_STORE_HPP
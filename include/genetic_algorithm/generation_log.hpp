@@ -0,0 +1,64 @@
+#ifndef GENERATION_LOG_HPP
+#define GENERATION_LOG_HPP
+
+#include "network_model/genome_hash.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Append-only binary log of the reported generations, written by a background thread.
+//
+// report() only moves a compact snapshot into a bounded queue, waiting while the writer
+// is queue_capacity snapshots behind. The writer stores every best genome as a delta from
+// the previous one and appends the snapshots in blocks of up to block_rows rows, column
+// by column, each block with a checksum so that a block torn by a crash ends the log.
+// A block is written once full, once the writer has been idle for flush_interval_ms, and
+// at close(). read() gives the snapshots back with their genomes rebuilt.
+class GenerationLog {
+public:
+    struct Snapshot {
+        std::int32_t generation = 0;
+        double best = 0;
+        double average = 0;
+        double exe_time = 0;
+        std::vector<std::uint32_t> genome; // Network::encode_instruction_tables of the best genome
+    };
+
+    static constexpr std::size_t queue_capacity = 16;
+    static constexpr std::size_t block_rows = 64;
+    static constexpr int flush_interval_ms = 1000;
+
+    GenerationLog() = default;
+    GenerationLog(const GenerationLog&) = delete;
+    GenerationLog& operator=(const GenerationLog&) = delete;
+    ~GenerationLog();
+
+    // Starts a new log, replacing any file at path
+    void open(const std::string& path, const Hash128& topology_hash);
+    // Writes what is still queued and stops the writer
+    void close();
+    bool is_open() const { return _fd >= 0; }
+
+    void report(Snapshot&& snapshot);
+
+    // Snapshots of the complete blocks of a log and the topology it was written for
+    static std::vector<Snapshot> read(const std::string& path, Hash128& topology_hash);
+
+private:
+    int _fd = -1;
+    std::thread _writer;
+    bool _stopping = false;
+    std::mutex _mtx;
+    std::condition_variable _queued_cv;
+    std::condition_variable _space_cv;
+    std::deque<Snapshot> _queue;
+
+    void write_loop();
+};
+
+#endif //GENERATION_LOG_HPP
@@ -0,0 +1,234 @@
+#ifndef ISLAND_MODEL_HPP
+#define ISLAND_MODEL_HPP
+
+#include "openGA.hpp"
+
+NS_EA_BEGIN;
+
+enum class MigrationTopology
+{
+	Ring,	// island i sends to island i+1
+	Random	// every island sends to another one drawn at each migration
+};
+
+/****************************************************
+* Island model: independent single objective Genetic
+* populations, each with its own share of the threads
+* and its own random streams, advanced generation by
+* generation in lockstep. Every migration_interval
+* generations the migration_size best chromosomes of
+* every island replace the last ranked ones of its
+* destination. The islands do not report themselves,
+* report_generation sees all of them at once.
+****************************************************/
+template<typename GeneType,typename MiddleCostType,typename Operators=FunctionOperators<GeneType,MiddleCostType>,typename RandomEngine=Philox>
+class IslandModel
+{
+public:
+
+	typedef Genetic<GeneType,MiddleCostType,Operators,RandomEngine> thisGeneticType;
+	typedef ChromosomeType<GeneType,MiddleCostType> thisChromosomeType;
+
+	struct IslandStats
+	{
+		double best_total_cost=std::numeric_limits<double>::infinity();
+		double average_cost=0.0;
+		double exe_time=0.0;
+		unsigned long immigrants=0;
+		StopReason stop=StopReason::Undefined;
+	};
+
+	unsigned int migration_interval;
+	unsigned int migration_size;
+	MigrationTopology migration_topology;
+	int N_threads;	// split between the islands
+	uint64_t random_seed;	// island seeds are derived from it
+	function<void(int,const IslandModel&)> report_generation;
+
+	IslandModel(unsigned int N_islands,const function<void(thisGeneticType&)> &configure) :
+		migration_interval(5),
+		migration_size(2),
+		migration_topology(MigrationTopology::Ring),
+		N_threads(std::thread::hardware_concurrency()),
+		report_generation(nullptr),
+		island_stats(N_islands),
+		generation_step(-1)
+	{
+		random_seed=std::chrono::high_resolution_clock::now().time_since_epoch().count();
+		if(N_threads==0) // number of CPU cores not detected.
+			N_threads=8;
+		islands.reserve(N_islands);
+		for(unsigned int i=0;i<N_islands;i++)
+		{
+			islands.push_back(unique_ptr<thisGeneticType>(new thisGeneticType()));
+			configure(*islands.back());
+		}
+	}
+
+	unsigned int size() const
+	{
+		return (unsigned int)islands.size();
+	}
+
+	thisGeneticType& island(unsigned int i)
+	{
+		return *islands[i];
+	}
+
+	const thisGeneticType& island(unsigned int i) const
+	{
+		return *islands[i];
+	}
+
+	const IslandStats& stats(unsigned int i) const
+	{
+		return island_stats[i];
+	}
+
+	int generation() const
+	{
+		return generation_step;
+	}
+
+	unsigned int best_island() const
+	{
+		unsigned int best=0;
+		for(unsigned int i=1;i<size();i++)
+			if(island_stats[i].best_total_cost<island_stats[best].best_total_cost)
+				best=i;
+		return best;
+	}
+
+	const thisChromosomeType& global_best() const
+	{
+		const auto &generation=islands[best_island()]->last_generation;
+		return generation.chromosomes[generation.best_chromosome_index];
+	}
+
+	StopReason solve()
+	{
+		if(islands.empty())
+			throw runtime_error("The island model has no island!");
+		if(report_generation==nullptr)
+			throw runtime_error("report_generation of the island model is not adjusted.");
+		if(migration_interval<1)
+			throw runtime_error("migration_interval is below 1.");
+		rng.seed(random_seed,~uint64_t(0));
+		unsigned int N_islands=size();
+		unsigned int N_total=(unsigned int)std::max(N_threads,1);
+		unsigned int first_cpu=0;
+		for(unsigned int i=0;i<N_islands;i++)
+		{
+			thisGeneticType &ga=*islands[i];
+			Philox seeder(random_seed,i);
+			ga.random_seed=seeder();
+			ga.N_threads=int(std::max(1u,N_total/N_islands+(i<N_total%N_islands?1:0)));
+			ga.first_pinned_cpu=first_cpu; // pinned islands take consecutive CPUs
+			first_cpu+=(unsigned int)ga.N_threads;
+			ga.SO_report_generation=[](int,const typename thisGeneticType::thisGenerationType&,const GeneType&){};
+			island_stats[i]=IslandStats();
+		}
+
+		generation_step=0;
+		run_on_islands([this](unsigned int i)
+			{
+				islands[i]->solve_init();
+			});
+		for(unsigned int i=0;i<N_islands;i++)
+			update_stats(i);
+		report_generation(generation_step,*this);
+
+		while(true)
+		{
+			generation_step++;
+			run_on_islands([this](unsigned int i)
+				{
+					island_stats[i].stop=islands[i]->solve_next_generation();
+				});
+			if(generation_step%int(migration_interval)==0)
+				migrate();
+			for(unsigned int i=0;i<N_islands;i++)
+				update_stats(i);
+			report_generation(generation_step,*this);
+			if(running_islands().empty())
+				break;
+		}
+		return island_stats[best_island()].stop;
+	}
+
+private:
+
+	vector<unique_ptr<thisGeneticType>> islands;
+	vector<IslandStats> island_stats;
+	int generation_step;
+	Philox rng;	// migration destinations
+
+	vector<unsigned int> running_islands() const
+	{
+		vector<unsigned int> running;
+		for(unsigned int i=0;i<size();i++)
+			if(island_stats[i].stop==StopReason::Undefined)
+				running.push_back(i);
+		return running;
+	}
+
+	// Runs action(i) for every island that did not stop, each on its own thread
+	void run_on_islands(const function<void(unsigned int)> &action)
+	{
+		vector<unsigned int> running=running_islands();
+		if(running.size()==1)
+		{
+			action(running[0]);
+			return ;
+		}
+		vector<std::thread> threads;
+		threads.reserve(running.size());
+		for(unsigned int i:running)
+			threads.push_back(std::thread(action,i));
+		for(std::thread &th:threads)
+			th.join();
+	}
+
+	unsigned int destination(unsigned int source)
+	{
+		unsigned int N_islands=size();
+		if(migration_topology==MigrationTopology::Ring)
+			return (source+1)%N_islands;
+		unsigned int hop=1+std::min((unsigned int)((N_islands-1)*rng.random01()),N_islands-2);
+		return (source+hop)%N_islands;
+	}
+
+	// All emigrants leave before any arrives, so that none travels twice
+	void migrate()
+	{
+		unsigned int N_islands=size();
+		if(N_islands<2 || migration_size==0)
+			return ;
+		vector<vector<thisChromosomeType>> arrivals(N_islands);
+		for(unsigned int i=0;i<N_islands;i++)
+		{
+			unsigned int to=destination(i);
+			if(island_stats[to].stop!=StopReason::Undefined)
+				continue; // a stopped island is left as it is
+			for(thisChromosomeType &X:islands[i]->emigrants(migration_size))
+				arrivals[to].push_back(std::move(X));
+		}
+		for(unsigned int i=0;i<N_islands;i++)
+		{
+			island_stats[i].immigrants+=arrivals[i].size();
+			islands[i]->immigrate(std::move(arrivals[i]));
+		}
+	}
+
+	void update_stats(unsigned int i)
+	{
+		const auto &generation=islands[i]->last_generation;
+		island_stats[i].best_total_cost=generation.best_total_cost;
+		island_stats[i].average_cost=generation.average_cost;
+		island_stats[i].exe_time=generation.exe_time;
+	}
+};
+
+NS_EA_END
+
+#endif //ISLAND_MODEL_HPP
@@ -0,0 +1,58 @@
+#ifndef MIGRATION_LINK_HPP
+#define MIGRATION_LINK_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Migrants exchanged between optimizer processes over stream sockets.
+//
+// Addresses are "host:port" for TCP or "unix:/path" for a Unix socket. Every process
+// listens on its own address and sends each message to every peer over a short-lived
+// connection, so a peer that is not up yet is simply skipped and reached at a later
+// broadcast once it has joined. Received messages wait in an inbox until receive().
+// Messages are binary, in the byte order of the hosts, which must agree.
+class MigrationLink {
+public:
+    struct Message {
+        std::string sender;
+        std::uint64_t tag = 0; // set to the tag of the sending link, messages with another tag than the receiver's are dropped
+        double best_cost = 0;
+        std::vector<std::pair<double, std::string>> migrants; // cost and serialized genome
+    };
+
+    explicit MigrationLink(std::uint64_t tag = 0): _tag(tag) {}
+    MigrationLink(const MigrationLink&) = delete;
+    MigrationLink& operator=(const MigrationLink&) = delete;
+    ~MigrationLink();
+
+    void listen(const std::string& address);
+    void add_peer(const std::string& address);
+    void close();
+
+    const std::string& address() const { return _address; }
+    std::uint64_t tag() const { return _tag; }
+    std::size_t n_peers() const { return _peers.size(); }
+
+    // Number of peers the message was delivered to
+    std::size_t broadcast(const Message& message);
+    std::vector<Message> receive();
+
+private:
+    std::uint64_t _tag;
+    std::string _address;
+    std::vector<std::string> _peers;
+    int _listen_fd = -1;
+    std::thread _receiver;
+    std::atomic<bool> _stopping{false};
+    std::mutex _inbox_mtx;
+    std::vector<Message> _inbox;
+
+    void receive_loop();
+};
+
+#endif //MIGRATION_LINK_HPP
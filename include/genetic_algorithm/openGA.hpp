@@ -18,6 +18,19 @@
 #include <functional>
 #include <mutex>
 #include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <memory>
+#include <numeric>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#endif
 
 #ifndef NS_EA_BEGIN
 #define NS_EA_BEGIN namespace EA {
@@ -70,7 +83,17 @@ struct GenerationType
 	vector<int> sorted_indices; // for single objective
 	vector<vector<unsigned int>> fronts; // for multi-objective
 	vector<double> selection_chance_cumulative;
+	vector<double> alias_probability; // Walker alias table of the roulette over selection_chance_cumulative
+	vector<unsigned int> alias_index;
+	vector<int> selection_rank; // rank of every chromosome, 0 is the best
+	bool ranking_valid=false; // sorted_indices and selection chances match the chromosomes
 	double exe_time;
+	unsigned int surrogate_audits=0; // offspring compared against a rejected candidate
+	unsigned int surrogate_hits=0; // audits where the surrogate's pick was not worse
+	double thread_startup_time=0.0; // seconds spent creating worker threads
+	unsigned long idle_wakeups=0; // worker wakeups that found no task
+	unsigned long steals=0; // task ranges taken over from another worker
+	vector<double> node_throughput; // tasks per second of a busy worker on each NUMA node, with pin_threads
 };
 
 template<typename GeneType,typename MiddleCostType>
@@ -205,6 +228,10 @@ public:
 
 	inline double& operator()(unsigned int row,unsigned int col) {return data[row*n_cols+col];}
 	inline double  operator()(unsigned int row,unsigned int col) const {return data[row*n_cols+col];}
+
+	// Rows are contiguous
+	inline double* row(unsigned int row_idx) {return data.data()+row_idx*n_cols;}
+	inline const double* row(unsigned int row_idx) const {return data.data()+row_idx*n_cols;}
 };
 
 inline double norm2(const vector<double> &x_vec)
@@ -239,7 +266,8 @@ enum class StopReason
 	MaxGenerations,
 	StallAverage,
 	StallBest,
-	UserRequest
+	UserRequest,
+	Deadline
 };
 
 class Chronometer
@@ -271,12 +299,519 @@ public:
 
 };
 
+/****************************************************
+* Philox4x32-10 counter-based generator (Salmon et al.,
+* "Parallel random numbers: as easy as 1, 2, 3", 2011).
+* Each (key, stream) pair is an independent sequence,
+* so every task can own a stream without any locking
+* and the draws do not depend on thread scheduling.
+****************************************************/
+class Philox
+{
+	uint32_t key[2];
+	uint32_t counter[4];	// block number in [0..1], stream in [2..3]
+	uint64_t buffer[2];
+	unsigned int position;
+
+	static void mulhilo(uint32_t a,uint32_t b,uint32_t &hi,uint32_t &lo)
+	{
+		uint64_t product=uint64_t(a)*b;
+		hi=uint32_t(product>>32);
+		lo=uint32_t(product);
+	}
+
+	void generate()
+	{
+		uint32_t c[4]={counter[0],counter[1],counter[2],counter[3]};
+		uint32_t k[2]={key[0],key[1]};
+		for(int round=0;round<10;round++)
+		{
+			if(round>0)
+			{
+				k[0]+=0x9E3779B9;
+				k[1]+=0xBB67AE85;
+			}
+			uint32_t hi0,lo0,hi1,lo1;
+			mulhilo(0xD2511F53,c[0],hi0,lo0);
+			mulhilo(0xCD9E8D57,c[2],hi1,lo1);
+			uint32_t next[4]={hi1^c[1]^k[0],lo1,hi0^c[3]^k[1],lo0};
+			std::copy(next,next+4,c);
+		}
+		buffer[0]=(uint64_t(c[1])<<32)|c[0];
+		buffer[1]=(uint64_t(c[3])<<32)|c[2];
+		position=0;
+		if(++counter[0]==0)
+			++counter[1];
+	}
+
+public:
+	typedef uint64_t result_type;
+
+	explicit Philox(uint64_t seed=0,uint64_t stream=0)
+	{
+		this->seed(seed,stream);
+	}
+
+	void seed(uint64_t seed,uint64_t stream=0)
+	{
+		key[0]=uint32_t(seed);
+		key[1]=uint32_t(seed>>32);
+		counter[0]=0;
+		counter[1]=0;
+		counter[2]=uint32_t(stream);
+		counter[3]=uint32_t(stream>>32);
+		position=2;
+	}
+
+	static constexpr result_type min() { return 0; }
+	static constexpr result_type max() { return ~uint64_t(0); }
+
+	result_type operator()()
+	{
+		if(position>=2)
+			generate();
+		return buffer[position++];
+	}
+
+	// Uniform in [0,1) from the upper 53 bits
+	double random01()
+	{
+		return double((*this)()>>11)*(1.0/9007199254740992.0);
+	}
+};
+
+/****************************************************
+* CPUs this process may run on, grouped by NUMA node
+* as /sys lists them, nodes numbered from 0 in that
+* order. CPUs of no listed node form one last node.
+* Outside Linux there is no CPU and no pinning.
+****************************************************/
+class CpuLayout
+{
+public:
+	vector<int> cpus;	// node by node
+	vector<unsigned int> cpu_node;	// node of every entry of cpus
+	unsigned int N_nodes=0;
+
+	static const CpuLayout& current()
+	{
+		static const CpuLayout layout=detect();
+		return layout;
+	}
+
+	// Pins the calling thread to one CPU, false when it cannot
+	static bool pin_current_thread(int cpu)
+	{
+#ifdef __linux__
+		cpu_set_t mask;
+		CPU_ZERO(&mask);
+		CPU_SET(cpu,&mask);
+		return sched_setaffinity(0,sizeof(mask),&mask)==0;
+#else
+		(void) cpu;
+		return false;
+#endif
+	}
+
+private:
+
+	// "0-3,8,10-11"
+	static vector<int> parse_cpu_list(const std::string &list)
+	{
+		vector<int> parsed;
+		std::stringstream ranges(list);
+		std::string range;
+		while(std::getline(ranges,range,','))
+		{
+			int first,last;
+			char dash;
+			std::stringstream bounds(range);
+			if(!(bounds>>first))
+				continue;
+			last=first;
+			if(bounds>>dash>>last && dash!='-')
+				last=first;
+			for(int cpu=first;cpu<=last;cpu++)
+				parsed.push_back(cpu);
+		}
+		return parsed;
+	}
+
+	static CpuLayout detect()
+	{
+		CpuLayout layout;
+#ifdef __linux__
+		cpu_set_t allowed;
+		CPU_ZERO(&allowed);
+		if(sched_getaffinity(0,sizeof(allowed),&allowed)!=0)
+			return layout;
+
+		vector<unsigned int> node_ids;
+		if(DIR *dir=opendir("/sys/devices/system/node"))
+		{
+			while(dirent *entry=readdir(dir))
+			{
+				unsigned int id;
+				char tail;
+				if(sscanf(entry->d_name,"node%u%c",&id,&tail)==1)
+					node_ids.push_back(id);
+			}
+			closedir(dir);
+		}
+		std::sort(node_ids.begin(),node_ids.end());
+
+		vector<bool> placed(CPU_SETSIZE,false);
+		auto add_node=[&layout,&allowed,&placed](const vector<int> &node_cpus)
+			{
+				bool added=false;
+				for(int cpu:node_cpus)
+					if(cpu>=0 && cpu<CPU_SETSIZE && CPU_ISSET(cpu,&allowed) && !placed[cpu])
+					{
+						placed[cpu]=true;
+						layout.cpus.push_back(cpu);
+						layout.cpu_node.push_back(layout.N_nodes);
+						added=true;
+					}
+				if(added)
+					layout.N_nodes++;
+			};
+		for(unsigned int id:node_ids)
+		{
+			std::ifstream file("/sys/devices/system/node/node"+std::to_string(id)+"/cpulist");
+			std::string list;
+			std::getline(file,list);
+			add_node(parse_cpu_list(list));
+		}
+		vector<int> remaining(CPU_SETSIZE);
+		std::iota(remaining.begin(),remaining.end(),0);
+		add_node(remaining);
+#endif
+		return layout;
+	}
+};
+
+class ThreadPool
+{
+	// Remaining task indices of one worker: the owner takes from the front, thieves split off the back
+	struct alignas(64) TaskRange
+	{
+		std::mutex mtx;
+		unsigned int begin=0;
+		unsigned int end=0;
+		// added to by the owner after each job, taken by take_node_throughput() at any time:
+		// a steady-state report takes them from a task while the other workers finish theirs
+		std::atomic<unsigned long> tasks_done{0};
+		std::atomic<std::chrono::nanoseconds::rep> busy_ns{0};
+	};
+
+	vector<std::thread> workers;
+	unique_ptr<TaskRange[]> ranges;
+	int first_cpu;	// -1 when the workers are not pinned
+	vector<unsigned int> worker_node;	// NUMA node of every worker, all 0 unless pinned
+	std::mutex mtx;
+	std::condition_variable work_cv;
+	std::condition_variable done_cv;
+	const function<void(unsigned int,unsigned int)> *task;
+	unsigned long job_id;
+	unsigned int active_workers;
+	bool stealing;
+	bool stopping;
+	std::atomic<unsigned long> idle_wakeups;
+	std::atomic<unsigned long> steals;
+
+public:
+
+	/****************************************************
+	* With first_cpu>=0, worker i is pinned to the CPU
+	* at (first_cpu+i) in CpuLayout::current().cpus, so
+	* consecutive workers, hence consecutive tasks, share
+	* a node. The memory a pinned worker allocates is
+	* first touched, so placed, on its own node.
+	****************************************************/
+	explicit ThreadPool(unsigned int N_workers,int first_cpu=-1) :
+		ranges(new TaskRange[N_workers]),
+		first_cpu(CpuLayout::current().cpus.empty()?-1:first_cpu),
+		worker_node(N_workers,0),
+		task(nullptr),
+		job_id(0),
+		active_workers(0),
+		stealing(true),
+		stopping(false),
+		idle_wakeups(0),
+		steals(0)
+	{
+		if(this->first_cpu>=0)
+		{
+			const CpuLayout &layout=CpuLayout::current();
+			for(unsigned int i=0;i<N_workers;i++)
+				worker_node[i]=layout.cpu_node[(this->first_cpu+i)%layout.cpus.size()];
+		}
+		workers.reserve(N_workers);
+		for(unsigned int i=0;i<N_workers;i++)
+			workers.push_back(std::thread(&ThreadPool::worker_loop,this,i));
+	}
+
+	ThreadPool(const ThreadPool&)=delete;
+	ThreadPool& operator=(const ThreadPool&)=delete;
+
+	~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mtx);
+			stopping=true;
+		}
+		work_cv.notify_all();
+		for(std::thread& th : workers)
+			th.join();
+	}
+
+	unsigned int size() const
+	{
+		return (unsigned int)workers.size();
+	}
+
+	int pinned_first_cpu() const
+	{
+		return first_cpu;
+	}
+
+	/****************************************************
+	* Run task(index,worker) for every index in [0,N_tasks)
+	* and return once all of them finished. The indices
+	* are split in equal contiguous ranges; with stealing
+	* a worker that runs out takes half of the remaining
+	* range of another one. When refresh is given it is
+	* called every refresh_period while waiting.
+	****************************************************/
+	void parallel_for(
+		unsigned int N_tasks,
+		const function<void(unsigned int,unsigned int)> &fn,
+		bool steal,
+		const function<void(void)> &refresh=nullptr,
+		std::chrono::microseconds refresh_period=std::chrono::microseconds(1000))
+	{
+		if(N_tasks==0)
+			return ;
+		std::unique_lock<std::mutex> lock(mtx);
+		unsigned int N_workers=size();
+		unsigned int chunk=N_tasks/N_workers, extra=N_tasks%N_workers, begin=0;
+		for(unsigned int i=0;i<N_workers;i++)
+		{
+			std::lock_guard<std::mutex> range_lock(ranges[i].mtx);
+			ranges[i].begin=begin;
+			begin+=chunk+(i<extra?1:0);
+			ranges[i].end=begin;
+		}
+		task=&fn;
+		stealing=steal;
+		active_workers=N_workers;
+		job_id++;
+		work_cv.notify_all();
+
+		if(refresh==nullptr)
+			done_cv.wait(lock,[this](){return active_workers==0;});
+		else
+			while(!done_cv.wait_for(lock,refresh_period,[this](){return active_workers==0;}))
+			{
+				lock.unlock();
+				refresh();
+				lock.lock();
+			}
+		task=nullptr;
+	}
+
+	unsigned long take_idle_wakeups()
+	{
+		return idle_wakeups.exchange(0);
+	}
+
+	unsigned long take_steals()
+	{
+		return steals.exchange(0);
+	}
+
+	// Tasks per second of a busy worker on each node since the last call, empty unless pinned
+	vector<double> take_node_throughput()
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		vector<double> throughput;
+		if(first_cpu<0)
+			return throughput;
+		unsigned int N_nodes=CpuLayout::current().N_nodes;
+		vector<unsigned long> tasks(N_nodes,0);
+		vector<double> busy(N_nodes,0.0);
+		for(unsigned int i=0;i<size();i++)
+		{
+			tasks[worker_node[i]]+=ranges[i].tasks_done.exchange(0,std::memory_order_relaxed);
+			busy[worker_node[i]]+=ranges[i].busy_ns.exchange(0,std::memory_order_relaxed)*1e-9;
+		}
+		throughput.assign(N_nodes,0.0);
+		for(unsigned int node=0;node<N_nodes;node++)
+			if(busy[node]>0)
+				throughput[node]=double(tasks[node])/busy[node];
+		return throughput;
+	}
+
+private:
+
+	bool next_task(unsigned int worker,unsigned int &index)
+	{
+		{
+			std::lock_guard<std::mutex> lock(ranges[worker].mtx);
+			if(ranges[worker].begin<ranges[worker].end)
+			{
+				index=ranges[worker].begin++;
+				return true;
+			}
+		}
+		if(!stealing)
+			return false;
+		// Workers of the same node first, their tasks are on the same memory
+		unsigned int N_workers=size();
+		for(int same_node=1;same_node>=0;same_node--)
+			for(unsigned int i=1;i<N_workers;i++)
+			{
+				unsigned int v=(worker+i)%N_workers;
+				if((worker_node[v]==worker_node[worker])!=bool(same_node))
+					continue;
+				TaskRange &victim=ranges[v];
+				unsigned int stolen_begin,stolen_end;
+				{
+					std::lock_guard<std::mutex> lock(victim.mtx);
+					if(victim.begin>=victim.end)
+						continue;
+					unsigned int mid=victim.begin+(victim.end-victim.begin)/2;
+					stolen_begin=mid;
+					stolen_end=victim.end;
+					victim.end=mid;
+				}
+				steals++;
+				std::lock_guard<std::mutex> lock(ranges[worker].mtx);
+				index=stolen_begin;
+				ranges[worker].begin=stolen_begin+1;
+				ranges[worker].end=stolen_end;
+				return true;
+			}
+		return false;
+	}
+
+	void worker_loop(unsigned int worker)
+	{
+		if(first_cpu>=0)
+		{
+			const CpuLayout &layout=CpuLayout::current();
+			CpuLayout::pin_current_thread(layout.cpus[(first_cpu+worker)%layout.cpus.size()]);
+		}
+		unsigned long seen_job=0;
+		while(true)
+		{
+			const function<void(unsigned int,unsigned int)> *job_task;
+			{
+				std::unique_lock<std::mutex> lock(mtx);
+				while(!stopping && job_id==seen_job)
+				{
+					work_cv.wait(lock);
+					if(!stopping && job_id==seen_job)
+						idle_wakeups++;
+				}
+				if(stopping)
+					return ;
+				seen_job=job_id;
+				job_task=task;
+			}
+
+			unsigned int index;
+			unsigned long worked=0;
+			auto start=std::chrono::steady_clock::now();
+			while(next_task(worker,index))
+			{
+				(*job_task)(index,worker);
+				worked++;
+			}
+			if(!worked)
+				idle_wakeups++;
+			else
+			{
+				ranges[worker].tasks_done.fetch_add(worked,std::memory_order_relaxed);
+				ranges[worker].busy_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+					std::chrono::steady_clock::now()-start).count(),std::memory_order_relaxed);
+			}
+
+			std::lock_guard<std::mutex> lock(mtx);
+			if(--active_workers==0)
+				done_cv.notify_all();
+		}
+	}
+};
+
+/****************************************************
+* Uniform draws in [0,1) from one random stream, the
+* rnd01 handed to the genetic operators. Operators
+* taking it as a template parameter inline the draws.
+****************************************************/
+template<typename RandomEngine>
+class RandomSource
+{
+public:
+	explicit RandomSource(RandomEngine *stream): stream(stream) {}
+
+	double operator()() const
+	{
+		return stream->random01();
+	}
+
+private:
+	RandomEngine *stream;
+};
+
+/****************************************************
+* Default operator policy of Genetic: init_genes,
+* eval_solution, mutate and crossover are set at run
+* time as std::function. Another policy provides the
+* same four members as function objects fixed at
+* compile time, with operator() templates taking any
+* rnd01, so that Genetic calls them directly:
+*
+*   struct Operators
+*   {
+*       struct Mutate
+*       {
+*           template<typename Random01>
+*           Gene operator()(const Gene&,const Random01 &rnd01,double shrink_scale) const;
+*       } mutate;
+*       ...
+*   };
+*   Genetic<Gene,Cost,Operators> ga;
+*
+* Interactive mode needs this default policy.
+****************************************************/
 template<typename GeneType,typename MiddleCostType>
-class Genetic
+struct FunctionOperators
+{
+	function<void(GeneType&,const function<double(void)> &rnd01)> init_genes;
+	function<bool(const GeneType&,MiddleCostType&)> eval_solution;
+	function<GeneType(const GeneType&,const function<double(void)> &rnd01,double shrink_scale)> mutate;
+	function<GeneType(const GeneType&,const GeneType&,const function<double(void)> &rnd01)> crossover;
+};
+
+// Whether a policy operator is available: a std::function may be left empty, a function object always is
+template<typename Signature>
+bool operator_set(const function<Signature> &op)
+{
+	return op!=nullptr;
+}
+
+template<typename Operator>
+bool operator_set(const Operator&)
+{
+	return true;
+}
+
+template<typename GeneType,typename MiddleCostType,typename Operators=FunctionOperators<GeneType,MiddleCostType>,typename RandomEngine=Philox>
+class Genetic: public Operators
 {
 private:
-	std::mt19937_64 rng; // random generator
-	std::uniform_real_distribution<double> unif_dist;
+	RandomEngine rng; // master stream, only drawn from the thread running the generations
 	int average_stall_count;
 	int best_stall_count;
 	vector<double> ideal_objectives;		// for multi-objective
@@ -284,10 +819,20 @@ private:
 	vector<double> scalarized_objectives_min;	// for multi-objective
 	Matrix reference_vectors;
 	unsigned int N_robj;
+	double racing_threshold;	// total cost an offspring has to beat to survive selection
+	std::atomic<unsigned int> surrogate_audits;
+	std::atomic<unsigned int> surrogate_hits;
+	unique_ptr<ThreadPool> thread_pool;	// created on first use and kept for the whole run
+	double thread_startup_time;
+	std::chrono::steady_clock::time_point deadline;	// with time_limit
+	vector<char> offspring_evaluated;	// offspring, or initial, slots filled before the deadline
+	std::atomic<unsigned int> initial_accepted;	// initial chromosomes evaluated so far
+	uint64_t scored_fidelity_key;	// fidelity_key() the costs of last_generation were evaluated at
 
 public:
 
-	typedef Genetic<GeneType,MiddleCostType> thisType;
+	typedef Genetic<GeneType,MiddleCostType,Operators,RandomEngine> thisType;
+	typedef RandomSource<RandomEngine> thisRandomSource;
 	typedef ChromosomeType<GeneType,MiddleCostType> thisChromosomeType;
 	typedef GenerationType<GeneType,MiddleCostType> thisGenerationType;
 	typedef GenerationType_SO_abstract<GeneType,MiddleCostType> thisGenSOAbs;
@@ -311,20 +856,34 @@ public:
 	bool multi_threading;
 	bool dynamic_threading;
 	int N_threads;
+	bool pin_threads = false;	// pin every worker thread to one CPU, filling NUMA nodes in turn
+	unsigned int first_pinned_cpu = 0;	// index in CpuLayout::current().cpus of the CPU of the first worker
 	bool user_request_stop;
-	long idle_delay_us;
-	bool use_quick_sort = true;
+	long idle_delay_us;	// custom_refresh period while waiting for worker threads
+	bool use_quick_sort = false;	// legacy recursive quicksort for ranking instead of std::sort
+	unsigned int parallel_sort_threshold = 10000;	// rank populations of this size on the thread pool
+	unsigned int parallel_association_threshold = 20000;	// chromosome-reference pairs from which NSGA-III associates on the thread pool
+	unsigned int tournament_size = 0;	// parents and survivors by tournament of this size, 0 for the rank roulette
+	bool steady_state = false;	// SOGA only: offspring replace the worst member as soon as they are evaluated
+	double time_limit = 0.0;	// seconds from solve_init() to stop at with StopReason::Deadline, 0 for none
+	unsigned int surrogate_candidates;	// offspring screened by surrogate_predict per evaluated one
+	double surrogate_audit_rate;	// chance of also evaluating a rejected candidate
+	uint64_t random_seed;	// master seed of all random streams, time-based unless set before solve()
 	vector<GeneType> user_initial_solutions;
 
 	function<void(thisGenerationType&)> calculate_IGA_total_fitness;
 	function<double(const thisChromosomeType&)> calculate_SO_total_fitness;
 	function<vector<double>(thisChromosomeType&)> calculate_MO_objectives;
 	function<vector<double>(const vector<double>&)> distribution_objective_reductions;
-	function<void(GeneType&,const function<double(void)> &rnd01)> init_genes;
-	function<bool(const GeneType&,MiddleCostType&)> eval_solution;
 	function<bool(const GeneType&,MiddleCostType&,const thisGenerationType&)> eval_solution_IGA;
-	function<GeneType(const GeneType&,const function<double(void)> &rnd01,double shrink_scale)> mutate;
-	function<GeneType(const GeneType&,const GeneType&,const function<double(void)> &rnd01)> crossover;
+	// optional, evaluates offspring (SOGA only) knowing the total cost of the current worst survivor;
+	// it may stop early and return a conservative cost for offspring that cannot survive selection
+	function<bool(const GeneType&,MiddleCostType&,double)> eval_solution_racing;
+	// optional, predicted total cost used to pre-screen offspring (SOGA only), NaN while untrained
+	function<double(const GeneType&)> surrogate_predict;
+	// optional, identifies the fidelity of eval_solution; when it changes between generations,
+	// the members carried over are evaluated again before competing with the offspring
+	function<uint64_t(void)> fidelity_key;
 	function<void(int,const thisGenerationType&,const GeneType&)> SO_report_generation;
 	function<void(int,const thisGenerationType&,const vector<unsigned int>&)> MO_report_generation;
 	function<void(void)> custom_refresh;
@@ -335,8 +894,12 @@ public:
 	////////////////////////////////////////////////////
 
 	Genetic() :
-		unif_dist(0.0,1.0),
 		N_robj(0),
+		racing_threshold(std::numeric_limits<double>::infinity()),
+		surrogate_audits(0),
+		surrogate_hits(0),
+		thread_startup_time(0.0),
+		scored_fidelity_key(0),
 		problem_mode(GA_MODE::SOGA),
 		population(50),
 		crossover_fraction(0.7),
@@ -356,25 +919,23 @@ public:
 		N_threads(std::thread::hardware_concurrency()),
 		user_request_stop(false),
 		idle_delay_us(1000),
+		surrogate_candidates(1),
+		surrogate_audit_rate(0.1),
 		calculate_IGA_total_fitness(nullptr),
 		calculate_SO_total_fitness(nullptr),
 		calculate_MO_objectives(nullptr),
 		distribution_objective_reductions(nullptr),
-		init_genes(nullptr),
-		eval_solution(nullptr),
 		eval_solution_IGA(nullptr),
-		mutate(nullptr),
-		crossover(nullptr),
+		eval_solution_racing(nullptr),
+		surrogate_predict(nullptr),
+		fidelity_key(nullptr),
 		SO_report_generation(nullptr),
 		MO_report_generation(nullptr),
 		custom_refresh(nullptr),
 		get_shrink_scale(default_shrink_scale)
 	{
-		// initialize the random number generator with time-dependent seed
-		uint64_t timeSeed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
-		std::seed_seq ss{uint32_t(timeSeed & 0xffffffff), uint32_t(timeSeed>>32)};
-		rng.seed(ss);
-		std::uniform_real_distribution<double> unif(0, 1);
+		// time-dependent seed, replace it before solve() to replay a run
+		random_seed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
 		if(N_threads==0) // number of CPU cores not detected.
 			N_threads=8;
 	}
@@ -404,6 +965,9 @@ public:
 	void solve_init()
 	{
 		check_settings();
+		deadline=std::chrono::steady_clock::now()
+			+std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(time_limit));
+		rng.seed(random_seed,~uint64_t(0));
 		// shrink_scale=1.0;
 		average_stall_count=0;
 		best_stall_count=0;
@@ -424,6 +988,7 @@ public:
 		timer.tic();
 
 		thisGenerationType generation0;
+		scored_fidelity_key=fidelity_key?fidelity_key():0;
 		init_population(generation0);
 
 		generation_step=0;
@@ -455,6 +1020,7 @@ public:
 			extreme_objectives.clear();
 			scalarized_objectives_min.clear();
 		}
+		take_thread_stats(generation0);
 		generation0.exe_time=timer.toc();
 		if(!user_request_stop)
 		{
@@ -462,35 +1028,55 @@ public:
 			report_generation(generation0);
 		}
 
-		last_generation=generation0;
+		last_generation=std::move(generation0);
 	}
 
+	/****************************************************
+	* With a time limit, offspring not evaluated by the
+	* deadline are dropped and the generation is ranked
+	* and reported with the others: last_generation only
+	* ever holds evaluated chromosomes.
+	****************************************************/
 	StopReason solve_next_generation()
 	{
+		if(deadline_passed())
+			return StopReason::Deadline;
 		Chronometer timer;
 		timer.tic();
+		if(!rescore_last_generation(true))
+			return StopReason::Deadline;
 		generation_step++;
+		update_racing_threshold();
 		thisGenerationType new_generation;
-		transfer(new_generation);
+		if(is_interactive())
+			transfer(new_generation); // IGA evaluations see the elites
 		crossover_and_mutation(new_generation);
+		if(user_request_stop)
+			return stop_critera(); // last_generation is left untouched
+		if(!is_interactive())
+			transfer(new_generation); // parents are moved in only once offspring exist
 
 		finalize_objectives(new_generation);
 		rank_population(new_generation);  // used for selection
 		thisGenerationType selected_generation;
 		select_population(new_generation,selected_generation);
-		new_generation=selected_generation;
-		rank_population(new_generation); // used for elite tranfre, crossover and mutation
+		new_generation=std::move(selected_generation);
+		new_generation.surrogate_audits=surrogate_audits.exchange(0);
+		new_generation.surrogate_hits=surrogate_hits.exchange(0);
+		take_thread_stats(new_generation);
+		if(!new_generation.ranking_valid) // SO selection derives it from the previous ranking
+			rank_population(new_generation); // used for elite tranfre, crossover and mutation
 		finalize_generation(new_generation);
 		new_generation.exe_time=timer.toc();
 
-		if(!user_request_stop)
+		bool reported=!user_request_stop;
+		if(reported)
 		{
 			generations_so_abs.push_back(thisGenSOAbs(new_generation));
 			report_generation(new_generation);
-			last_generation=new_generation;
 		}
-		if(!new_generation.fronts.empty())
-			last_generation=new_generation;
+		if(reported || !new_generation.fronts.empty())
+			last_generation=std::move(new_generation);
 		return stop_critera();
 	}
 
@@ -498,13 +1084,47 @@ public:
 	{
 		StopReason stop=StopReason::Undefined;
 		solve_init();
+		if(steady_state)
+			stop=solve_steady_state();
 		while(stop==StopReason::Undefined)
 			stop=solve_next_generation();
 		show_stop_reason(stop);
 		return stop;
 	}
 
-	std::string stop_reason_to_string(StopReason stop)
+	// Copies of the count best chromosomes of last_generation (SO only), sent to another population
+	vector<thisChromosomeType> emigrants(unsigned int count)
+	{
+		if(!is_single_objective())
+			throw runtime_error("Migration is only available in single objective mode!");
+		count=std::min(count,(unsigned int)last_generation.sorted_indices.size());
+		vector<thisChromosomeType> migrants;
+		migrants.reserve(count);
+		for(unsigned int i=0;i<count;i++)
+			migrants.push_back(last_generation.chromosomes[last_generation.sorted_indices[i]]);
+		return migrants;
+	}
+
+	/****************************************************
+	* Evaluated chromosomes of another population take
+	* the places of the last ranked ones of last_gener-
+	* ation (SO only), which is then ranked again.
+	****************************************************/
+	void immigrate(vector<thisChromosomeType> &&migrants)
+	{
+		if(!is_single_objective())
+			throw runtime_error("Migration is only available in single objective mode!");
+		unsigned int N=(unsigned int)last_generation.sorted_indices.size();
+		unsigned int count=std::min((unsigned int)migrants.size(),N);
+		for(unsigned int i=0;i<count;i++)
+			last_generation.chromosomes[last_generation.sorted_indices[N-1-i]]=std::move(migrants[i]);
+		if(count==0)
+			return ;
+		rank_population(last_generation);
+		finalize_generation(last_generation);
+	}
+
+	std::string stop_reason_to_string(StopReason stop) const
 	{
 		switch(stop)
 		{
@@ -523,6 +1143,9 @@ public:
 			case StopReason::UserRequest:
 				return "User request";
 				break;
+			case StopReason::Deadline:
+				return "Deadline reached";
+				break;
 			default:
 				return "Unknown reason";
 		}
@@ -540,13 +1163,66 @@ protected:
 		return scale;
 	}
 
+	// Stream of the task running on this thread, null outside tasks
+	static RandomEngine*& task_rng()
+	{
+		static thread_local RandomEngine *stream=nullptr;
+		return stream;
+	}
+
+	// Every new solution draws from its own stream keyed by generation and slot, so a run
+	// is reproduced exactly from random_seed whatever the number of threads.
+	uint64_t task_stream(unsigned int index) const
+	{
+		return (uint64_t(uint32_t(generation_step))<<32)|index;
+	}
+
 	double random01()
 	{
-		std::lock_guard<std::mutex> lock(mtx_rand); // prevent data race between threads
-		return unif_dist(rng);
+		RandomEngine *stream=task_rng();
+		return stream!=nullptr?stream->random01():rng.random01();
+	}
+
+	// rnd01 of the operators, drawing from the stream of the current task
+	thisRandomSource random_source()
+	{
+		RandomEngine *stream=task_rng();
+		return thisRandomSource(stream!=nullptr?stream:&rng);
 	}
 
 
+	/****************************************************
+	* The cost an offspring has to beat to survive the
+	* next selection. The elites keep their places, and
+	* the population-elite_count other places go to the
+	* best of the other members and the N_add offspring
+	* were selection a truncation. Offspring ranking as
+	* the members do, the cut-off is the member at that
+	* share of the non-elite ranks. The roulette still
+	* gives worse offspring a chance, which the racing
+	* confidence bound leaves them.
+	****************************************************/
+	void update_racing_threshold()
+	{
+		racing_threshold=std::numeric_limits<double>::infinity();
+		int N=int(last_generation.chromosomes.size());
+		if(!is_single_objective() || N==0)
+			return ;
+		int N_elites=std::min(std::max(elite_count,0),N);
+		int N_add=int(std::round(double(population)*crossover_fraction));
+		int N_places=std::max(int(population)-N_elites,0);
+		int N_others=N-N_elites;
+		int cut=N-1;
+		if(N_places+N_add>0)
+			cut=N_elites+int(std::ceil(double(N_places)*N_others/(N_places+N_add)))-1;
+		cut=std::min(std::max(cut,0),N-1);
+		vector<double> costs(N);
+		for(int i=0;i<N;i++)
+			costs[i]=last_generation.chromosomes[i].total_cost;
+		std::nth_element(costs.begin(),costs.begin()+cut,costs.end());
+		racing_threshold=costs[cut];
+	}
+
 	void report_generation(const thisGenerationType &new_generation)
 	{
 		if(is_single_objective())
@@ -581,15 +1257,67 @@ protected:
 		}
 	}
 
+	/****************************************************
+	* When fidelity_key() changed since last_generation
+	* was evaluated, its members are evaluated again, so
+	* that selection never compares costs of different
+	* fidelities. False when the deadline cut this short,
+	* last_generation is then left as it was.
+	****************************************************/
+	bool rescore_last_generation(bool pooled)
+	{
+		if(fidelity_key==nullptr || is_interactive())
+			return true;
+		uint64_t key=fidelity_key();
+		if(key==scored_fidelity_key)
+			return true;
+		vector<thisChromosomeType> &chromosomes=last_generation.chromosomes;
+		vector<MiddleCostType> costs(chromosomes.size());
+		function<void(unsigned int,unsigned int)> rescore=
+			[this,&chromosomes,&costs](unsigned int index,unsigned int)
+			{
+				if(!deadline_passed())
+					this->eval_solution(chromosomes[index].genes,costs[index]);
+			};
+		if(!pooled || !multi_threading || N_threads==1)
+		{
+			for(unsigned int i=0;i<chromosomes.size();i++)
+				rescore(i,0);
+		}
+		else
+		{
+			ThreadPool &pool=worker_pool();
+			if(custom_refresh!=nullptr)
+				pool.parallel_for((unsigned int)chromosomes.size(),rescore,dynamic_threading,custom_refresh,std::chrono::microseconds(std::max(idle_delay_us,1L)));
+			else
+				pool.parallel_for((unsigned int)chromosomes.size(),rescore,dynamic_threading);
+		}
+		if(deadline_passed())
+			return false;
+		for(unsigned int i=0;i<chromosomes.size();i++)
+			chromosomes[i].middle_costs=std::move(costs[i]);
+		scored_fidelity_key=key;
+		finalize_objectives(last_generation);
+		rank_population(last_generation);
+		finalize_generation(last_generation);
+		return true;
+	}
+
 	void transfer(thisGenerationType &new_generation)
 	{
 		if(user_request_stop)
 			return ;
 
 		if(!is_interactive())
-		{ // add all members
-			for(thisChromosomeType c:last_generation.chromosomes)
-				new_generation.chromosomes.push_back(c);
+		{ // add all members in front of the offspring, last_generation is replaced afterwards
+			vector<thisChromosomeType> offspring;
+			offspring.swap(new_generation.chromosomes);
+			new_generation.chromosomes.reserve(last_generation.chromosomes.size()+offspring.size());
+			for(thisChromosomeType &c:last_generation.chromosomes)
+				new_generation.chromosomes.push_back(std::move(c));
+			for(thisChromosomeType &c:offspring)
+				new_generation.chromosomes.push_back(std::move(c));
+			last_generation.chromosomes.clear();
 		}
 		else
 		{
@@ -644,7 +1372,11 @@ protected:
 				throw runtime_error("MO_report_generation is not null in interactive mode!");
 			if(eval_solution_IGA==nullptr)
 				throw runtime_error("eval_solution_IGA is null in interactive mode!");
-			if(eval_solution!=nullptr)
+			if(eval_solution_racing!=nullptr)
+				throw runtime_error("eval_solution_racing is not null in interactive mode!");
+			if(surrogate_predict!=nullptr)
+				throw runtime_error("surrogate_predict is not null in interactive mode!");
+			if(operator_set(this->eval_solution))
 				throw runtime_error("eval_solution is not null in interactive mode (use eval_solution_IGA instead)!");
 		}
 		else
@@ -653,7 +1385,7 @@ protected:
 				throw runtime_error("calculate_IGA_total_fitness is not null in non-interactive mode!");
 			if(eval_solution_IGA!=nullptr)
 				throw runtime_error("eval_solution_IGA is not null in non-interactive mode!");
-			if(eval_solution==nullptr)
+			if(!operator_set(this->eval_solution))
 				throw runtime_error("eval_solution is null!");
 			if(is_single_objective())
 			{
@@ -668,6 +1400,10 @@ protected:
 			}
 			else
 			{
+				if(eval_solution_racing!=nullptr)
+					throw runtime_error("eval_solution_racing is not null in multi-objective mode!");
+				if(surrogate_predict!=nullptr)
+					throw runtime_error("surrogate_predict is not null in multi-objective mode!");
 				if(calculate_SO_total_fitness!=nullptr)
 					throw runtime_error("calculate_SO_total_fitness is no null in multi-objective mode!");
 				if(calculate_MO_objectives==nullptr)
@@ -679,12 +1415,19 @@ protected:
 			}
 		}
 
-		if(init_genes==nullptr)
+		if(time_limit<0.0)
+			throw runtime_error("time_limit is negative.");
+		if(time_limit>0.0 && is_interactive())
+			throw runtime_error("time_limit is not available in interactive mode!");
+
+		if(!operator_set(this->init_genes))
 			throw runtime_error("init_genes is not adjusted.");
-		if(mutate==nullptr)
+		if(!operator_set(this->mutate))
 			throw runtime_error("mutate is not adjusted.");
-		if(crossover==nullptr)
+		if(!operator_set(this->crossover))
 			throw runtime_error("crossover is not adjusted.");
+		if(steady_state && (is_interactive() || !is_single_objective()))
+			throw runtime_error("steady_state is only available in single objective mode!");
 		if(N_threads<1)
 			throw runtime_error("Number of threads is below 1.");
 		if(population<1)
@@ -705,7 +1448,8 @@ protected:
 		}
 	}
 
-	void select_population(const thisGenerationType &g,thisGenerationType &g2)
+	// Chromosomes of g are moved into g2, g is consumed
+	void select_population(thisGenerationType &g,thisGenerationType &g2)
 	{
 		if(user_request_stop)
 			return ;
@@ -731,7 +1475,7 @@ protected:
 				ideal_objectives=g.chromosomes[0].objectives;
 		}
 		unsigned int N_r_objectives=(unsigned int)ideal_objectives.size();
-		for(thisChromosomeType x:g.chromosomes)
+		for(const thisChromosomeType &x:g.chromosomes)
 		{
 			vector<double> obj_reduced;
 			if(distribution_objective_reductions)
@@ -744,12 +1488,12 @@ protected:
 		}
 	}
 
-	void select_population_MO(const thisGenerationType &g,thisGenerationType &g2)
+	void select_population_MO(thisGenerationType &g,thisGenerationType &g2)
 	{
 		update_ideal_objectives(g,false);
 		if(generation_step<=0)
 		{
-			g2=g;
+			g2=std::move(g);
 			return ;
 		}
 		g2.chromosomes.clear();
@@ -777,7 +1521,7 @@ protected:
 				norm_objectives(i,j)=zb_objectives(i,j)/intercepts[j];
 		if(g.chromosomes.size()==population)
 		{
-			g2=g;
+			g2=std::move(g);
 			return ;
 		}
 		if(reference_vectors.empty())
@@ -807,7 +1551,7 @@ protected:
 		while(g2.chromosomes.size()+g.fronts[last_front_index].size()<=population)
 		{
 			for(unsigned int i:g.fronts[last_front_index])
-				g2.chromosomes.push_back(g.chromosomes[i]);
+				g2.chromosomes.push_back(std::move(g.chromosomes[i]));
 			last_front_index++;
 		}
 		vector<unsigned int> last_front=g.fronts[last_front_index];
@@ -869,9 +1613,15 @@ protected:
 			niche_count[min_niche_index]++;
 		}
 		for(unsigned int i:to_add)
-			g2.chromosomes.push_back(g.chromosomes[i]);
+			g2.chromosomes.push_back(std::move(g.chromosomes[i]));
 	}
 
+	/****************************************************
+	* Every chromosome is associated with the reference
+	* vector at the shortest perpendicular distance. The
+	* rows are independent, large populations split them
+	* between the workers of the thread pool.
+	****************************************************/
 	void associate_to_references(
 		const thisGenerationType &gen,
 		const Matrix &norm_objectives,
@@ -882,46 +1632,73 @@ protected:
 	{
 		unsigned int N_ref=reference_vectors.get_n_rows();
 		unsigned int N_x=(unsigned int)gen.chromosomes.size();
+		unsigned int N_obj=norm_objectives.get_n_cols();
+		assert(reference_vectors.get_n_cols()==N_obj && "Vector size mismatch! A349687921");
 		niche_count.assign(N_ref, 0);
 		distances.zeros(N_x,N_ref); // row: pop, col: ref_vec
 		associated_ref_vector.assign(gen.chromosomes.size(),0);
 		distance_ref_vector.assign(gen.chromosomes.size(),0.0);
-		for(unsigned int i=0;i<N_x;i++)
+
+		Matrix directions=reference_vectors;
+		for(unsigned int j=0;j<N_ref;j++)
 		{
-			double dist_min=0.0;   // to avoid uninitialization warning
-			unsigned int dist_min_index=0; // to avoid uninitialization warning
-			for(unsigned int j=0;j<N_ref;j++)
+			vector<double> reference_vectors_row_j;
+			reference_vectors.get_row(j,reference_vectors_row_j);
+			double ref_vec_j_norm2=norm2(reference_vectors_row_j);
+			for(unsigned int k=0;k<N_obj;k++)
+				directions(j,k)/=ref_vec_j_norm2;
+		}
+
+		auto associate_rows=[&](unsigned int begin,unsigned int end)
 			{
-				vector<double> reference_vectors_row_j;
-				reference_vectors.get_row(j,reference_vectors_row_j);
-				double ref_vec_j_norm2=norm2(reference_vectors_row_j);
-				vector<double> w=reference_vectors_row_j;
-				for(double &x:w)
-					x/=ref_vec_j_norm2;
-				vector<double> norm_obj;
-				norm_objectives.get_row(i,norm_obj);
-				assert(w.size()==norm_obj.size() && "Vector size mismatch! A349687921");
-				double scalar_wtnorm=0.0;
-				for(unsigned int k=0;k<norm_obj.size();k++)
-					scalar_wtnorm+=w[k]*norm_obj[k];
-				double dist2=0.0;
-				for(unsigned int k=0;k<norm_obj.size();k++)
+				for(unsigned int i=begin;i<end;i++)
 				{
-					double dist_x=norm_obj[k]-scalar_wtnorm*w[k];
-					dist2+=dist_x*dist_x;
+					const double *norm_obj=norm_objectives.row(i);
+					double *distances_i=distances.row(i);
+					double dist_min=0.0;   // to avoid uninitialization warning
+					unsigned int dist_min_index=0; // to avoid uninitialization warning
+					for(unsigned int j=0;j<N_ref;j++)
+					{
+						const double *w=directions.row(j);
+						double scalar_wtnorm=0.0;
+						for(unsigned int k=0;k<N_obj;k++)
+							scalar_wtnorm+=w[k]*norm_obj[k];
+						double dist2=0.0;
+						for(unsigned int k=0;k<N_obj;k++)
+						{
+							double dist_x=norm_obj[k]-scalar_wtnorm*w[k];
+							dist2+=dist_x*dist_x;
+						}
+						double dist=sqrt(dist2);
+						distances_i[j]=dist;
+						if(j==0||dist<dist_min)
+						{
+							dist_min=dist;
+							dist_min_index=j;
+						}
+					}
+					associated_ref_vector[i]=dist_min_index;
+					distance_ref_vector[i]=dist_min;
 				}
-				double dist=sqrt(dist2);
-				distances(i,j)=dist;
-				if(j==0||dist<dist_min)
+			};
+
+		if((unsigned long)N_x*N_ref>=parallel_association_threshold && multi_threading && N_threads>1 && !is_interactive())
+		{
+			ThreadPool &pool=worker_pool();
+			unsigned int N_chunks=pool.size();
+			pool.parallel_for(N_chunks,
+				[&associate_rows,N_x,N_chunks](unsigned int chunk,unsigned int)
 				{
-					dist_min=dist;
-					dist_min_index=j;
-				}
-			}
-			associated_ref_vector[i]=dist_min_index;
-			distance_ref_vector[i]=dist_min;
-			niche_count[dist_min_index]++;
+					associate_rows(
+						(unsigned int)((unsigned long)N_x*chunk/N_chunks),
+						(unsigned int)((unsigned long)N_x*(chunk+1)/N_chunks));
+				},true);
 		}
+		else
+			associate_rows(0,N_x);
+
+		for(unsigned int i=0;i<N_x;i++)
+			niche_count[associated_ref_vector[i]]++;
 	}
 
 	void build_hyperplane_intercepts(vector<double> &xinv)
@@ -1020,21 +1797,25 @@ protected:
 
 	}
 
-	void select_population_SO(const thisGenerationType &g,thisGenerationType &g2)
+	void select_population_SO(thisGenerationType &g,thisGenerationType &g2)
 	{
 		if(generation_step<=0)
 		{
-			g2=g;
+			g2=std::move(g);
 			return ;
 		}
 
 		if(verbose)
 			cout<<"Transfered elites: ";
-		vector<int> blocked;
+		vector<bool> blocked(g.chromosomes.size(),false);
+		vector<int> source; // chromosome of g behind every chromosome of g2
+		g2.chromosomes.reserve(population);
+		source.reserve(population);
 		for(int i=0;i<elite_count;i++)
 		{
-			g2.chromosomes.push_back(g.chromosomes[g.sorted_indices[i]]);
-			blocked.push_back(g.sorted_indices[i]);
+			source.push_back(g.sorted_indices[i]);
+			g2.chromosomes.push_back(std::move(g.chromosomes[g.sorted_indices[i]]));
+			blocked[g.sorted_indices[i]]=true;
 			if(verbose)
 			{
 				cout<<(i==0?"":", ");
@@ -1043,25 +1824,75 @@ protected:
 		}
 		if(verbose)
 			cout<<endl;
-		for(int i=0;i<int(population)-elite_count;i++)
+		int N_drawn=std::min(int(population),int(g.chromosomes.size()))-elite_count;
+		for(int j:draw_survivors(g,blocked,N_drawn))
 		{
-			int j;
-			bool allowed;
-			do
-			{
-				allowed=true;
-				j=select_parent(g);
-				for(int k=0;k<int(blocked.size()) && allowed;k++)
-					if(blocked[k]==j)
-						allowed=false;
-			} while(!allowed);
-			g2.chromosomes.push_back(g.chromosomes[j]);
-			blocked.push_back(g.sorted_indices[j]);
+			source.push_back(j);
+			g2.chromosomes.push_back(std::move(g.chromosomes[j]));
 		}
+		if(g.ranking_valid)
+			rank_selected_SO(g,g2,source);
 		if(verbose)
 			cout<<"Selection done."<<endl;
 	}
 
+	/****************************************************
+	* n chromosomes of g that are not blocked, drawn
+	* without replacement over the whole generation and
+	* without any retry. Tournaments are held among the
+	* chromosomes still free, the winner leaving them.
+	* The rank roulette gives every free chromosome the
+	* key log(u)/w, w its chance, and keeps the n largest
+	* keys (Efraimidis-Spirakis): the same distribution
+	* as roulette draws that skip the chromosomes already
+	* taken, in O(N).
+	****************************************************/
+	vector<int> draw_survivors(const thisGenerationType &g,const vector<bool> &blocked,int n)
+	{
+		vector<int> free;
+		free.reserve(g.chromosomes.size());
+		for(int i=0;i<int(g.chromosomes.size());i++)
+			if(!blocked[i])
+				free.push_back(i);
+		n=std::max(0,std::min(n,int(free.size())));
+		vector<int> survivors;
+		survivors.reserve(n);
+		if(tournament_size>0)
+		{
+			for(int k=0;k<n;k++)
+			{
+				int winner=-1;
+				for(unsigned int t=0;t<tournament_size;t++)
+				{
+					int contender=std::min(int(free.size()*random01()),int(free.size())-1);
+					if(winner<0 || g.chromosomes[free[contender]].total_cost<g.chromosomes[free[winner]].total_cost)
+						winner=contender;
+				}
+				survivors.push_back(free[winner]);
+				free[winner]=free.back();
+				free.pop_back();
+			}
+			return survivors;
+		}
+
+		vector<double> key(g.chromosomes.size(),-std::numeric_limits<double>::infinity());
+		for(int i:free)
+		{
+			double u=std::max(random01(),std::numeric_limits<double>::min());
+			key[i]=std::log(u)*std::sqrt(double(g.selection_rank[i]+1)); // log(u)/w, w=1/sqrt(rank+1)
+		}
+		if(n==0)
+			return survivors;
+		auto before=[&key](int a,int b){return key[a]>key[b] || (key[a]==key[b] && a<b);};
+		vector<int> order(free);
+		std::nth_element(order.begin(),order.begin()+(n-1),order.end(),before);
+		int last=order[n-1];
+		for(int i:free)
+			if(!before(last,i))
+				survivors.push_back(i);
+		return survivors;
+	}
+
 	void rank_population(thisGenerationType &gen)
 	{
 		if(user_request_stop)
@@ -1071,6 +1902,7 @@ protected:
 			rank_population_SO(gen);
 		else
 			rank_population_MO(gen);
+		gen.ranking_valid=true;
 	}
 
 	void quicksort_indices_SO(vector<int> &array_indices,const thisGenerationType &gen,int left ,int right)
@@ -1105,23 +1937,39 @@ protected:
 	void rank_population_SO(thisGenerationType &gen)
 	{
 		int N=int(gen.chromosomes.size());
-		gen.sorted_indices.clear();
-		gen.sorted_indices.reserve(N);
+		gen.sorted_indices.resize(N);
 		for(int i=0;i<N;i++)
-			gen.sorted_indices.push_back(i);
+			gen.sorted_indices[i]=i;
+		// ties go by index, so that the order does not depend on how many chunks sort it
+		auto by_cost=[&gen](int a,int b)->bool
+			{
+				double cost_a=gen.chromosomes[a].total_cost,cost_b=gen.chromosomes[b].total_cost;
+				return cost_a<cost_b || (cost_a==cost_b && a<b);
+			};
 
-		if (use_quick_sort)
+		if(tournament_size>0)
 		{
-			quicksort_indices_SO(gen.sorted_indices,gen,0,int(gen.sorted_indices.size())-1);
+			// Tournaments compare costs directly: only the elites need to be in order, and
+			// the worst chromosome is kept at the back
+			int N_head=std::min(std::max(elite_count,0),N);
+			std::partial_sort(gen.sorted_indices.begin(),gen.sorted_indices.begin()+N_head,gen.sorted_indices.end(),by_cost);
+			if(N_head<N)
+				std::iter_swap(
+					std::max_element(gen.sorted_indices.begin()+N_head,gen.sorted_indices.end(),by_cost),
+					gen.sorted_indices.end()-1);
+			gen.selection_rank.clear();
+			gen.selection_chance_cumulative.clear();
+			gen.alias_probability.clear();
+			gen.alias_index.clear();
+			return ;
 		}
+
+		if(use_quick_sort)
+			quicksort_indices_SO(gen.sorted_indices,gen,0,N-1);
+		else if(N>=int(parallel_sort_threshold) && multi_threading && N_threads>1 && !is_interactive())
+			parallel_sort_indices(gen.sorted_indices,by_cost);
 		else
-		{
-			std::sort(gen.sorted_indices.begin(), gen.sorted_indices.end(),
-				[&gen](int a,int b)->bool
-				{
-					return gen.chromosomes[a].total_cost < gen.chromosomes[b].total_cost;
-				});
-		}
+			std::sort(gen.sorted_indices.begin(),gen.sorted_indices.end(),by_cost);
 
 		vector<int> ranks;
 		ranks.assign(gen.chromosomes.size(),0);
@@ -1131,10 +1979,79 @@ protected:
 		generate_selection_chance(gen,ranks);
 	}
 
-	void generate_selection_chance(thisGenerationType &gen,const vector<int> &rank)
+	/****************************************************
+	* Sorts chunks of the indices on the thread pool and
+	* merges them pairwise, also on the pool.
+	****************************************************/
+	template<typename Compare>
+	void parallel_sort_indices(vector<int> &indices,const Compare &comp)
 	{
-		double chance_cumulative=0.0;
-		unsigned int N=(unsigned int)gen.chromosomes.size();
+		ThreadPool &pool=worker_pool();
+		unsigned int N_chunks=pool.size();
+		vector<size_t> bounds(N_chunks+1);
+		for(unsigned int i=0;i<=N_chunks;i++)
+			bounds[i]=indices.size()*i/N_chunks;
+		pool.parallel_for(N_chunks,
+			[&indices,&bounds,&comp](unsigned int chunk,unsigned int)
+			{
+				std::sort(indices.begin()+bounds[chunk],indices.begin()+bounds[chunk+1],comp);
+			},false);
+		for(unsigned int width=1;width<N_chunks;width*=2)
+			pool.parallel_for((N_chunks+2*width-1)/(2*width),
+				[&indices,&bounds,&comp,width,N_chunks](unsigned int merge,unsigned int)
+				{
+					unsigned int first=2*merge*width;
+					size_t mid=bounds[std::min(first+width,N_chunks)];
+					size_t last=bounds[std::min(first+2*width,N_chunks)];
+					std::inplace_merge(indices.begin()+bounds[first],indices.begin()+mid,indices.begin()+last,comp);
+				},false);
+	}
+
+	/****************************************************
+	* Ranking of the survivors g2, which are the chromo-
+	* somes source[k] of the ranked generation g. Their
+	* order follows from the ranks in g, without any new
+	* comparison (a counting sort over those ranks).
+	****************************************************/
+	void rank_selected_SO(const thisGenerationType &g,thisGenerationType &g2,const vector<int> &source)
+	{
+		int N2=int(g2.chromosomes.size());
+		g2.sorted_indices.resize(N2);
+		if(tournament_size>0)
+		{
+			// the elites come first and in order, only the worst is looked up
+			for(int i=0;i<N2;i++)
+				g2.sorted_indices[i]=i;
+			int N_head=std::min(std::max(elite_count,0),N2);
+			if(N_head<N2)
+				std::iter_swap(
+					std::max_element(g2.sorted_indices.begin()+N_head,g2.sorted_indices.end(),
+						[&g2](int a,int b){return g2.chromosomes[a].total_cost<g2.chromosomes[b].total_cost;}),
+					g2.sorted_indices.end()-1);
+			g2.ranking_valid=true;
+			return ;
+		}
+
+		vector<int> position(g.chromosomes.size()+1,0);
+		for(int k=0;k<N2;k++)
+			position[g.selection_rank[source[k]]+1]++;
+		for(size_t r=1;r<position.size();r++)
+			position[r]+=position[r-1];
+		vector<int> ranks(N2);
+		for(int k=0;k<N2;k++)
+		{
+			int slot=position[g.selection_rank[source[k]]]++;
+			g2.sorted_indices[slot]=k;
+			ranks[k]=slot;
+		}
+		generate_selection_chance(g2,ranks);
+		g2.ranking_valid=true;
+	}
+
+	void generate_selection_chance(thisGenerationType &gen,const vector<int> &rank)
+	{
+		double chance_cumulative=0.0;
+		unsigned int N=(unsigned int)gen.chromosomes.size();
 		gen.selection_chance_cumulative.clear();
 		gen.selection_chance_cumulative.reserve(N);
 		for(unsigned int i=0;i<N;i++)
@@ -1144,55 +2061,95 @@ protected:
 		}
 		for(unsigned int i=0;i<N;i++)
 		{	// normalizing
-			gen.selection_chance_cumulative[i]=gen.selection_chance_cumulative[i]/gen.selection_chance_cumulative[population-1];
+			gen.selection_chance_cumulative[i]=gen.selection_chance_cumulative[i]/gen.selection_chance_cumulative[std::min(population,N)-1];
 		}
+		gen.selection_rank=rank;
+		build_alias_table(gen);
 	}
 
-	void rank_population_MO(thisGenerationType &gen)
+	/****************************************************
+	* Walker alias table (Vose's construction) of the
+	* roulette, for O(1) draws. As with the cumulative
+	* chances, only the first population entries can be
+	* drawn.
+	****************************************************/
+	void build_alias_table(thisGenerationType &gen)
 	{
-		vector<vector<unsigned int>> domination_set;
-		vector<int> dominated_count;
-		domination_set.reserve(gen.chromosomes.size());
-		dominated_count.reserve(gen.chromosomes.size());
-		for(unsigned int i=0;i<gen.chromosomes.size();i++)
+		unsigned int M=(unsigned int)std::min<size_t>(gen.selection_chance_cumulative.size(),population);
+		if(M==0)
+		{
+			gen.alias_probability.clear();
+			gen.alias_index.clear();
+			return ;
+		}
+		vector<double> weights(M);
+		double previous=0.0;
+		for(unsigned int i=0;i<M;i++)
 		{
-			domination_set.push_back({});
-			dominated_count.push_back(0);
+			weights[i]=gen.selection_chance_cumulative[i]-previous;
+			previous=gen.selection_chance_cumulative[i];
 		}
-		vector<unsigned int> pareto_front;
+		build_alias_table(weights,gen.selection_chance_cumulative[M-1],gen.alias_probability,gen.alias_index);
+	}
 
-		for(unsigned int i=0;i<gen.chromosomes.size();i++)
+	// Alias table of weights summing to total
+	static void build_alias_table(const vector<double> &weights,double total,vector<double> &probability,vector<unsigned int> &alias)
+	{
+		unsigned int M=(unsigned int)weights.size();
+		probability.assign(M,1.0);
+		alias.resize(M);
+		if(M==0)
+			return ;
+		vector<double> scaled(M);
+		for(unsigned int i=0;i<M;i++)
+			scaled[i]=weights[i]*M/total;
+		vector<unsigned int> small,large;
+		for(unsigned int i=0;i<M;i++)
+		{
+			alias[i]=i;
+			(scaled[i]<1.0?small:large).push_back(i);
+		}
+		while(!small.empty() && !large.empty())
 		{
-			for(unsigned int j=i+1;j<gen.chromosomes.size();j++)
+			unsigned int l=small.back(),g=large.back();
+			small.pop_back();
+			probability[l]=scaled[l];
+			alias[l]=g;
+			scaled[g]=(scaled[g]+scaled[l])-1.0;
+			if(scaled[g]<1.0)
 			{
-				if(dominates(gen.chromosomes[i],gen.chromosomes[j]))
-				{
-					domination_set[i].push_back(j);
-					dominated_count[j]++;
-				}
-				if(dominates(gen.chromosomes[j],gen.chromosomes[i]))
-				{
-					domination_set[j].push_back(i);
-					dominated_count[i]++;
-				}
+				large.pop_back();
+				small.push_back(g);
 			}
-			if(dominated_count[i]==0)
-				pareto_front.push_back(i);
 		}
-		gen.fronts.clear();
-		gen.fronts.push_back(pareto_front);
-		vector<unsigned int> next_front;
-		do
+		// the rest is 1 up to rounding
+		for(unsigned int i:small)
+			probability[i]=1.0;
+		for(unsigned int i:large)
+			probability[i]=1.0;
+	}
+
+	// Entry drawn from an alias table with r uniform in [0,1)
+	static unsigned int alias_draw(const vector<double> &probability,const vector<unsigned int> &alias,double r)
+	{
+		unsigned int M=(unsigned int)alias.size();
+		double scaled=r*M;
+		unsigned int column=std::min((unsigned int)scaled,M-1);
+		return scaled-column<probability[column]?column:alias[column];
+	}
+
+	void rank_population_MO(thisGenerationType &gen)
+	{
+		unsigned int N=(unsigned int)gen.chromosomes.size();
+		unsigned int M=N?(unsigned int)gen.chromosomes[0].objectives.size():0;
+		Matrix objectives(N,M);
+		for(unsigned int i=0;i<N;i++)
 		{
-			next_front.clear();
-			vector<unsigned int> &last_front=gen.fronts[gen.fronts.size()-1];
-			for(unsigned int i:last_front)
-				for(unsigned int j:domination_set[i])
-					if(--dominated_count[j]==0)
-						next_front.push_back(j);
-			if(!next_front.empty())
-				gen.fronts.push_back(next_front);
-		} while (!next_front.empty());
+			if(gen.chromosomes[i].objectives.size()!=M)
+				throw runtime_error("vector size mismatch A73592753!");
+			std::copy(gen.chromosomes[i].objectives.begin(),gen.chromosomes[i].objectives.end(),objectives.row(i));
+		}
+		non_dominated_fronts(objectives,gen.fronts);
 		vector<int> ranks;
 		ranks.assign(gen.chromosomes.size(),0);
 		for(unsigned int i=0;i<gen.fronts.size();i++)
@@ -1201,17 +2158,87 @@ protected:
 		generate_selection_chance(gen,ranks);
 	}
 
+	/****************************************************
+	* Efficient non-dominated sort with binary search
+	* (ENS-BS). Taken in lexicographic order, a row can
+	* only be dominated by rows taken before it, whose
+	* fronts are then final. A row dominated by a member
+	* of front k is also dominated by one of every front
+	* before k, so its front, the first without any
+	* dominator, is found by binary search. Each probe
+	* of a front compares x with its members, so the sort
+	* takes O(M.N.log N) comparisons when the fronts are
+	* small and many, as with few objectives M. With many
+	* objectives most rows are mutually non-dominated, a
+	* few large fronts hold the population and the worst
+	* case is O(M.N^2), like the fast non-dominated sort
+	* of NSGA-II. The rows of each front are listed in
+	* increasing order.
+	****************************************************/
+	static void non_dominated_fronts(const Matrix &objectives,vector<vector<unsigned int>> &fronts)
+	{
+		unsigned int N=objectives.get_n_rows(), M=objectives.get_n_cols();
+		vector<unsigned int> order(N);
+		std::iota(order.begin(),order.end(),0u);
+		std::sort(order.begin(),order.end(),
+			[&objectives,M](unsigned int a,unsigned int b)
+			{
+				const double *x=objectives.row(a), *y=objectives.row(b);
+				for(unsigned int k=0;k<M;k++)
+					if(x[k]!=y[k])
+						return x[k]<y[k];
+				return a<b;
+			});
+
+		fronts.clear();
+		for(unsigned int i:order)
+		{
+			const double *x=objectives.row(i);
+			unsigned int low=0, high=(unsigned int)fronts.size();
+			while(low<high)
+			{
+				unsigned int mid=(low+high)/2;
+				if(front_dominates(objectives,fronts[mid],x))
+					low=mid+1;
+				else
+					high=mid;
+			}
+			if(low==fronts.size())
+				fronts.push_back({});
+			fronts[low].push_back(i);
+		}
+		for(vector<unsigned int> &front:fronts)
+			std::sort(front.begin(),front.end());
+	}
+
+	// The last rows added to a front are the closest to x in the lexicographic order
+	static bool front_dominates(const Matrix &objectives,const vector<unsigned int> &front,const double *x)
+	{
+		unsigned int M=objectives.get_n_cols();
+		for(auto it=front.rbegin();it!=front.rend();++it)
+			if(dominates(objectives.row(*it),x,M))
+				return true;
+		return false;
+	}
+
+	static bool dominates(const double *a,const double *b,unsigned int M)
+	{
+		bool better=false;
+		for(unsigned int k=0;k<M;k++)
+		{
+			if(a[k]>b[k])
+				return false;
+			if(a[k]<b[k])
+				better=true;
+		}
+		return better;
+	}
+
 	bool dominates(const thisChromosomeType &a,const thisChromosomeType &b)
 	{
 		if(a.objectives.size()!=b.objectives.size())
 			throw runtime_error("vector size mismatch A73592753!");
-		for(unsigned int i=0;i<a.objectives.size();i++)
-			if(a.objectives[i]>b.objectives[i])
-				return false;
-		for(unsigned int i=0;i<a.objectives.size();i++)
-			if(a.objectives[i]<b.objectives[i])
-				return true;
-		return false;
+		return dominates(a.objectives.data(),b.objectives.data(),(unsigned int)a.objectives.size());
 	}
 
 	vector<vector<double>> 
@@ -1288,21 +2315,21 @@ protected:
 			if(eval_solution_IGA(X.genes,X.middle_costs,generation0))
 			{
 				// in IGA mode, code cannot run in parallel.
-				generation0.chromosomes.push_back(X);
+				generation0.chromosomes.push_back(std::move(X));
 				return true;
 			}
 		}
 		else
 		{
-			if(eval_solution(X.genes,X.middle_costs))
+			if(this->eval_solution(X.genes,X.middle_costs))
 			{
 				if(index>=0)
 				{
-					generation0.chromosomes[index]=X;
+					generation0.chromosomes[index]=std::move(X);
 				}
 				else
 				{	
-					generation0.chromosomes.push_back(X);
+					generation0.chromosomes.push_back(std::move(X));
 				}
 				return true;
 			}
@@ -1320,23 +2347,46 @@ protected:
 		for(int index=index_from;index<=index_to;index++)
 		{
 			bool accepted=false;
-			while(!accepted)
+			// past the deadline no evaluation starts, once there is one individual to report
+			while(!accepted && !(deadline_passed() && initial_accepted>0))
 			{
 				thisChromosomeType X;
-				init_genes(X.genes,[this](){return random01();});
+				this->init_genes(X.genes,random_source());
 				accepted = init_population_try(*p_generation0,X,index);
 				(*attemps)++;
 			}
+			if(accepted)
+			{
+				initial_accepted++;
+				if(index>=0)
+					offspring_evaluated[index]=1;
+			}
 			active_thread=false;		
 		}
 	}
 
-	void idle()
+	ThreadPool& worker_pool()
 	{
-		if(custom_refresh!=nullptr)
-			custom_refresh();
-		if(idle_delay_us>0)
-			std::this_thread::sleep_for(std::chrono::microseconds(idle_delay_us));
+		int first_cpu=(pin_threads && !CpuLayout::current().cpus.empty())?int(first_pinned_cpu):-1;
+		if(!thread_pool || thread_pool->size()!=(unsigned int)N_threads || thread_pool->pinned_first_cpu()!=first_cpu)
+		{
+			Chronometer timer;
+			timer.tic();
+			thread_pool.reset();
+			thread_pool.reset(new ThreadPool((unsigned int)N_threads,first_cpu));
+			thread_startup_time+=timer.toc();
+		}
+		return *thread_pool;
+	}
+
+	// Pool statistics accumulated since the previous generation
+	void take_thread_stats(thisGenerationType &generation)
+	{
+		generation.thread_startup_time=thread_startup_time;
+		thread_startup_time=0.0;
+		generation.idle_wakeups=thread_pool?thread_pool->take_idle_wakeups():0;
+		generation.steals=thread_pool?thread_pool->take_steals():0;
+		generation.node_throughput=thread_pool?thread_pool->take_node_throughput():vector<double>();
 	}
 
 	/****************************************************
@@ -1351,195 +2401,90 @@ protected:
 		unsigned int N_add, unsigned int &total_attempts)
 	{
 		std::atomic<bool> dummy;
+		unsigned int offset = (unsigned int)generation.chromosomes.size();
 		for(unsigned int i=0;i<N_add && !user_request_stop;i++)
+		{
+			RandomEngine stream(random_seed,task_stream(offset+i));
+			task_rng()=&stream;
 			(this->*action_function)(&generation,-1,-1,&total_attempts,dummy);
+			task_rng()=nullptr;
+		}
 	}
 
 	/****************************************************
 	* Perform a given method action (population 
-	* initialization, or mutation/crossover) in a thread pool.
-	* The method is called by any available thread.
+	* initialization, or mutation/crossover) in the
+	* persistent thread pool, one solution per task.
+	* With work stealing, the solutions of a worker
+	* that lags behind are taken over by idle ones;
+	* without it every worker keeps its equal share.
 	****************************************************/
 	template <void (thisType::*action_function)(thisGenerationType *p_generation0,int index_from,int index_to,unsigned int *attemps,std::atomic<bool> &active_thread)>
-	void dynamic_thread_action(
+	void pooled_action(
 		thisGenerationType &generation,
-		unsigned int N_add, unsigned int &total_attempts)
+		unsigned int N_add, unsigned int &total_attempts,
+		bool steal)
 	{
-		vector<atomic<bool>> active_threads(N_threads);
-		for (auto& at : active_threads)
-			std::atomic_init(&at, false);
-
+		ThreadPool &pool=worker_pool();
 		vector<unsigned int> attempts;
-		attempts.assign(N_threads,0);
-
-		// Initialize the thread pool
-		vector<std::thread> thread_pool;
-		thread_pool.reserve(N_threads);
-		for(int i=0;i<N_threads;i++)
-		{
-			thread_pool.push_back(std::thread());
-		}
-		for(std::thread& th : thread_pool)
-		{
-			if(th.joinable())
-			{
-				th.join();
-			}
-		}
+		attempts.assign(pool.size(),0);
 
 		unsigned int offset = (unsigned int)generation.chromosomes.size();
-
 		// Pre-fill the new solutions
 		for(unsigned int i=0;i<N_add;i++)
-		{
 			generation.chromosomes.push_back(thisChromosomeType());
-		}
 
-		unsigned int x_index=0;
-		while(x_index<N_add && !user_request_stop)
-		{
-			int free_thread=-1;
-			for(int i=0;i<N_threads && free_thread<0;i++)
-				if(!active_threads[i])
-				{
-					free_thread=i;
-					if(thread_pool[free_thread].joinable())
-					{
-						thread_pool[free_thread].join();
-					}
-				}
-			if(free_thread>-1)
+		function<void(unsigned int,unsigned int)> task=
+			[this,&generation,&attempts,offset](unsigned int index,unsigned int worker)
 			{
-				active_threads[free_thread]=true;
-				thread_pool[free_thread]=
-					std::thread(
-						action_function,
-						this,
-						&generation,
-						offset + int(x_index), /* from */
-						offset + int(x_index), /* to */
-						&attempts[free_thread],
-						std::ref(active_threads[free_thread])
-							);
-				x_index++;
-			}
-			else
-			{
-				idle();
-			}
-		}
-
-		bool all_tasks_finished;
-		do
-		{
-			all_tasks_finished=true;
-			for(int i=0;i<N_threads;i++)
-				if(active_threads[i])
-					all_tasks_finished=false;
-			if(!all_tasks_finished)
-				idle();
-		}while(!all_tasks_finished);
-
-		// wait for tasks to finish
-		for(std::thread& th : thread_pool)
-			if(th.joinable())
-				th.join();
+				if(user_request_stop)
+					return ;
+				std::atomic<bool> active_thread(true);
+				RandomEngine stream(random_seed,task_stream(offset+index));
+				task_rng()=&stream;
+				(this->*action_function)(
+					&generation,
+					int(offset+index), /* from */
+					int(offset+index), /* to */
+					&attempts[worker],
+					active_thread);
+				task_rng()=nullptr;
+			};
+		if(custom_refresh!=nullptr)
+			pool.parallel_for(N_add,task,steal,custom_refresh,std::chrono::microseconds(std::max(idle_delay_us,1L)));
+		else
+			pool.parallel_for(N_add,task,steal);
 
 		for(unsigned int ac:attempts)
 			total_attempts+=ac;
 	}
 
+	template <void (thisType::*action_function)(thisGenerationType *p_generation0,int index_from,int index_to,unsigned int *attemps,std::atomic<bool> &active_thread)>
+	void dynamic_thread_action(
+		thisGenerationType &generation,
+		unsigned int N_add, unsigned int &total_attempts)
+	{
+		pooled_action<action_function>(generation,N_add,total_attempts,true);
+	}
 
-	/****************************************************
-	* Perform a given method action (population 
-	* initialization, or mutation/crossover) in a thread
-	* pool. The task is equally divided between threads.
-	* This approach has far less thread numbers and hence
-	* less far thread overhhead. However, as the thread
-	* allocation is not dynamic, the whole process waits 
-	* for the worst-case-scenario thread. 
-	****************************************************/
 	template <void (thisType::*action_function)(thisGenerationType *p_generation0,int index_from,int index_to,unsigned int *attemps,std::atomic<bool> &active_thread)>
 	void static_thread_action(
 		thisGenerationType &generation,
 		unsigned int N_add, unsigned int &total_attempts)
 	{
-		vector<atomic<bool>> active_threads(N_threads);
-		for (auto& at : active_threads)
-			std::atomic_init(&at, false);
-
-		vector<unsigned int> attempts;
-		attempts.assign(N_threads,0);
-
-		// Initialize the thread pool
-		vector<std::thread> thread_pool;
-		thread_pool.reserve(N_threads);
-		for(int i=0;i<N_threads;i++)
-			thread_pool.push_back(std::thread());
-		for(std::thread& th : thread_pool)
-			if(th.joinable())
-				th.join();
-
-		unsigned int offset = (unsigned int)generation.chromosomes.size();
-		// Pre-fill the new solutions
-		for(unsigned int i=0;i<N_add;i++)
-			generation.chromosomes.push_back(thisChromosomeType());
-
-		// Use determined thread pools
-		int x_index_start=offset;
-		int x_index_end=0;
-		int pop_chunk=std::max(int(N_add/N_threads),1);
-		for(int i=0;i<N_threads;i++)
-		{
-			if(i+1==N_threads) // last chunk
-				x_index_end=int(generation.chromosomes.size())-1;
-			else
-				x_index_end=std::min(x_index_start+pop_chunk-1,int(generation.chromosomes.size())-1);
-
-			if(x_index_end>=x_index_start)
-			{
-				active_threads[i]=true;
-				thread_pool[i]=
-				std::thread(
-					action_function,
-					this,
-					&generation,
-					x_index_start,
-					x_index_end,
-					&attempts[i],
-					std::ref(active_threads[i])
-						);
-			}
-			x_index_start=x_index_end+1;
-		}
-
-		bool all_tasks_finished;
-		do
-		{
-			all_tasks_finished=true;
-			for(int i=0;i<N_threads;i++)
-				if(active_threads[i])
-					all_tasks_finished=false;
-			if(!all_tasks_finished)
-				idle();
-		}while(!all_tasks_finished);
-
-		// wait for tasks to finish
-		for(std::thread& th : thread_pool)
-			if(th.joinable())
-				th.join();
-
-		for(unsigned int ac:attempts)
-			total_attempts+=ac;
+		pooled_action<action_function>(generation,N_add,total_attempts,false);
 	}
 
 	/****************************************************
-	* This function generates the initial population
+	* This function generates the initial population.
+	* With a time limit, the chromosomes not evaluated
+	* by the deadline are left out, as long as one was.
 	****************************************************/
 	void init_population(thisGenerationType &generation0)
 	{
 		generation0.chromosomes.clear();
 		generation0.chromosomes.reserve(population); // push_back can invalidate the vector
+		initial_accepted=0;
 
 		unsigned int new_solutions_offset = (unsigned int) generation0.chromosomes.size();
 		unsigned int N_add=(unsigned int) std::max(0, int(population)-int(new_solutions_offset));
@@ -1563,6 +2508,8 @@ protected:
 		}
 		else
 		{
+			offspring_evaluated.assign(generation0.chromosomes.size()+N_add,0);
+			std::fill(offspring_evaluated.begin(),offspring_evaluated.begin()+generation0.chromosomes.size(),1);
 			if(dynamic_threading)
 			{
 				// Perform the tasks by any available thread
@@ -1575,6 +2522,14 @@ protected:
 				static_thread_action<&thisType::init_population_range>(
 					generation0,N_add,total_attempts);
 			}
+			if(deadline_passed())
+			{ // drop the slots of the chromosomes the deadline cut off
+				unsigned int kept=0;
+				for(unsigned int i=0;i<generation0.chromosomes.size();i++)
+					if(offspring_evaluated[i])
+						generation0.chromosomes[kept++]=std::move(generation0.chromosomes[i]);
+				generation0.chromosomes.resize(kept);
+			}
 		}
 
 		/////////////////////
@@ -1588,13 +2543,116 @@ protected:
 	int select_parent(const thisGenerationType &g)
 	{
 		int N_max=int(g.chromosomes.size());
+		if(tournament_size>0)
+		{
+			int winner=-1;
+			for(unsigned int i=0;i<tournament_size;i++)
+			{
+				int contender=std::min(int(N_max*random01()),N_max-1);
+				bool better=winner<0 || (is_single_objective()?
+					g.chromosomes[contender].total_cost<g.chromosomes[winner].total_cost:
+					g.selection_rank[contender]<g.selection_rank[winner]);
+				if(better)
+					winner=contender;
+			}
+			return winner;
+		}
 		double r=random01();
+		if(!g.alias_index.empty())
+			return int(alias_draw(g.alias_probability,g.alias_index,r));
 		int position=0;
 		while(position<N_max && g.selection_chance_cumulative[position]<r)
 			position++;
 		return position;
 	}
 
+	// Genes of a new offspring, returned by value so that they are never default-constructed first
+	GeneType make_offspring()
+	{
+		int pidx_c1,pidx_c2;
+		do
+		{
+			pidx_c1=select_parent(last_generation);
+			pidx_c2=select_parent(last_generation);
+		} while(pidx_c1==pidx_c2);
+		if(verbose)
+			cout<<"Crossover of chromosomes "<<pidx_c1<<","<<pidx_c2<<endl;
+		return breed(
+			last_generation.chromosomes[pidx_c1].genes,
+			last_generation.chromosomes[pidx_c2].genes,
+			generation_step);
+	}
+
+	// Crossover of two parents followed by a mutation with probability mutation_rate
+	GeneType breed(const GeneType &Xp1,const GeneType &Xp2,int step)
+	{
+		GeneType genes=this->crossover(Xp1,Xp2,random_source());
+		if(random01()<=mutation_rate)
+		{
+			if(verbose)
+				cout<<"Mutation of chromosome "<<endl;
+			double shrink_scale=get_shrink_scale(step,random_source());
+			genes=this->mutate(genes,random_source(),shrink_scale);
+		}
+		return genes;
+	}
+
+	/****************************************************
+	* Replaces genes by the best of surrogate_candidates
+	* offspring according to surrogate_predict, the
+	* other candidates coming from next_candidate.
+	* Returns one rejected candidate when this offspring
+	* is chosen for auditing the surrogate, null other-
+	* wise.
+	****************************************************/
+	unique_ptr<thisChromosomeType> screen_offspring(GeneType &genes,const function<GeneType(void)> &next_candidate)
+	{
+		double best_prediction=surrogate_predict(genes);
+		if(std::isnan(best_prediction))
+			return nullptr;
+		vector<GeneType> rejected;
+		for(unsigned int i=1;i<surrogate_candidates;i++)
+		{
+			GeneType candidate=next_candidate();
+			double prediction=surrogate_predict(candidate);
+			if(prediction<best_prediction)
+			{
+				best_prediction=prediction;
+				std::swap(genes,candidate);
+			}
+			rejected.push_back(std::move(candidate));
+		}
+		if(rejected.empty() || random01()>=surrogate_audit_rate)
+			return nullptr;
+		unsigned int audit_index=(unsigned int)std::floor(rejected.size()*random01());
+		return unique_ptr<thisChromosomeType>(new thisChromosomeType{
+			std::move(rejected[std::min(audit_index,(unsigned int)rejected.size()-1)]),MiddleCostType(),0.0,{}});
+	}
+
+	// Genes of an offspring, screened by the surrogate; Y is set when a rejected candidate audits it
+	thisChromosomeType screened_offspring(unique_ptr<thisChromosomeType> &Y)
+	{
+		thisChromosomeType X{make_offspring(),MiddleCostType(),0.0,{}};
+		if(surrogate_predict!=nullptr && surrogate_candidates>1)
+			Y=screen_offspring(X.genes,[this](){return make_offspring();});
+		return X;
+	}
+
+	// Non-interactive evaluation of an offspring, false when it is rejected
+	bool evaluate_offspring(thisChromosomeType &X,const unique_ptr<thisChromosomeType> &Y)
+	{
+		bool accepted=(eval_solution_racing!=nullptr)?
+			eval_solution_racing(X.genes,X.middle_costs,racing_threshold):
+			this->eval_solution(X.genes,X.middle_costs);
+		if(accepted && Y && this->eval_solution(Y->genes,Y->middle_costs))
+		{
+			surrogate_audits++;
+			if(calculate_SO_total_fitness(X)<=calculate_SO_total_fitness(*Y))
+				surrogate_hits++;
+		}
+		return accepted;
+	}
+
 	void crossover_and_mutation_range(
 		thisGenerationType *p_new_generation,
 		int x_index_begin,
@@ -1608,31 +2666,15 @@ protected:
 				cout<<"Action: crossover"<<endl;
 
 			bool successful=false;
-			while(!successful)
+			while(!successful && !deadline_passed())
 			{
-				thisChromosomeType X;
-
-				int pidx_c1=select_parent(last_generation);
-				int pidx_c2=select_parent(last_generation);
-				if(pidx_c1==pidx_c2)
-					continue ;
-				if(verbose)
-					cout<<"Crossover of chromosomes "<<pidx_c1<<","<<pidx_c2<<endl;
-				GeneType Xp1=last_generation.chromosomes[pidx_c1].genes;
-				GeneType Xp2=last_generation.chromosomes[pidx_c2].genes;
-				X.genes=crossover(Xp1,Xp2,[this](){return random01();});
-				if(random01()<=mutation_rate)
-				{
-					if(verbose)
-						cout<<"Mutation of chromosome "<<endl;
-					double shrink_scale=get_shrink_scale(generation_step,[this](){return random01();});
-					X.genes=mutate(X.genes,[this](){return random01();},shrink_scale);
-				}
+				unique_ptr<thisChromosomeType> Y; // rejected candidate to audit the surrogate with
+				thisChromosomeType X=screened_offspring(Y);
 				if(is_interactive())
 				{
 					if(eval_solution_IGA(X.genes,X.middle_costs,*p_new_generation))
 					{
-						p_new_generation->chromosomes.push_back(X);
+						p_new_generation->chromosomes.push_back(std::move(X));
 						successful=true;
 					}
 					else
@@ -1640,12 +2682,15 @@ protected:
 				}
 				else
 				{
-					if(eval_solution(X.genes,X.middle_costs))
+					if(evaluate_offspring(X,Y))
 					{
 						if(index>=0)
-							p_new_generation->chromosomes[index]=X;
+						{
+							p_new_generation->chromosomes[index]=std::move(X);
+							offspring_evaluated[index]=1;
+						}
 						else
-							p_new_generation->chromosomes.push_back(X);
+							p_new_generation->chromosomes.push_back(std::move(X));
 						successful=true;
 					}
 					else
@@ -1657,6 +2702,94 @@ protected:
 		active_thread=false;
 	}
 
+	/****************************************************
+	* Offspring of a generation the deadline may cut
+	* short: all of them are bred first, on their usual
+	* streams, then evaluated in increasing order of
+	* surrogate_predict, so that the most promising ones
+	* are scored before the deadline. Pooled tasks take
+	* the next offspring in that order, not their index.
+	****************************************************/
+	void prioritized_crossover_and_mutation(thisGenerationType &new_generation,unsigned int N_add)
+	{
+		unsigned int offset=(unsigned int)new_generation.chromosomes.size();
+		vector<RandomEngine> streams;
+		streams.reserve(N_add);
+		for(unsigned int i=0;i<N_add;i++)
+			streams.push_back(RandomEngine(random_seed,task_stream(offset+i)));
+		vector<thisChromosomeType> offspring(N_add);
+		vector<unique_ptr<thisChromosomeType>> audits(N_add);
+		vector<double> predictions(N_add);
+		run_offspring_tasks(N_add,[&](unsigned int i)
+			{
+				task_rng()=&streams[i];
+				offspring[i]=screened_offspring(audits[i]);
+				task_rng()=nullptr;
+				predictions[i]=surrogate_predict(offspring[i].genes);
+			});
+
+		vector<unsigned int> order(N_add);
+		std::iota(order.begin(),order.end(),0u);
+		std::stable_sort(order.begin(),order.end(),
+			[&predictions](unsigned int a,unsigned int b)
+			{ // unknown predictions last
+				return !std::isnan(predictions[a]) && (std::isnan(predictions[b]) || predictions[a]<predictions[b]);
+			});
+		offspring_evaluated.assign(N_add,0);
+		std::atomic<unsigned int> next(0);
+		run_offspring_tasks(N_add,[&](unsigned int)
+			{
+				unsigned int i=order[next++];
+				task_rng()=&streams[i];
+				bool accepted=false;
+				while(!deadline_passed() && !(accepted=evaluate_offspring(offspring[i],audits[i])))
+				{
+					audits[i].reset();
+					offspring[i]=screened_offspring(audits[i]);
+				}
+				task_rng()=nullptr;
+				offspring_evaluated[i]=accepted;
+			});
+
+		for(unsigned int i=0;i<N_add;i++)
+			if(offspring_evaluated[i])
+				new_generation.chromosomes.push_back(std::move(offspring[i]));
+	}
+
+	// Runs task(i) for i in [0,N) on the thread pool when multi-threading, in order otherwise
+	void run_offspring_tasks(unsigned int N,const function<void(unsigned int)> &task)
+	{
+		if(!multi_threading || N_threads==1)
+		{
+			for(unsigned int i=0;i<N && !user_request_stop;i++)
+				task(i);
+			return ;
+		}
+		function<void(unsigned int,unsigned int)> pooled=
+			[this,&task](unsigned int index,unsigned int)
+			{
+				if(!user_request_stop)
+					task(index);
+			};
+		ThreadPool &pool=worker_pool();
+		if(custom_refresh!=nullptr)
+			pool.parallel_for(N,pooled,dynamic_threading,custom_refresh,std::chrono::microseconds(std::max(idle_delay_us,1L)));
+		else
+			pool.parallel_for(N,pooled,dynamic_threading);
+	}
+
+	bool deadline_passed() const
+	{
+		return time_limit>0.0 && std::chrono::steady_clock::now()>=deadline;
+	}
+
+	// A deadline within the time the last generation took
+	bool deadline_near() const
+	{
+		return time_limit>0.0 && generation_step>0
+			&& std::chrono::duration<double>(deadline-std::chrono::steady_clock::now()).count()<last_generation.exe_time;
+	}
+
 	void crossover_and_mutation(thisGenerationType &new_generation)
 	{
 		if(user_request_stop)
@@ -1677,6 +2810,12 @@ protected:
 				throw runtime_error("In IGA mode, elite fraction + crossover fraction must be equal to 1.0 !");
 		}
 
+		if(deadline_near() && surrogate_predict!=nullptr)
+		{
+			prioritized_crossover_and_mutation(new_generation,N_add);
+			return ;
+		}
+		offspring_evaluated.assign(N_add,0);
 		if(!multi_threading || N_threads==1 || is_interactive())
 		{
 			sequential_action<&thisType::crossover_and_mutation_range>(
@@ -1696,6 +2835,14 @@ protected:
 				static_thread_action<&thisType::crossover_and_mutation_range>(
 					new_generation,N_add,total_attempts);
 			}
+			if(deadline_passed())
+			{ // drop the slots of the offspring the deadline cut off
+				unsigned int kept=0;
+				for(unsigned int i=0;i<N_add;i++)
+					if(offspring_evaluated[i])
+						new_generation.chromosomes[kept++]=std::move(new_generation.chromosomes[i]);
+				new_generation.chromosomes.resize(kept);
+			}
 		}
 
 		if(verbose)
@@ -1704,8 +2851,220 @@ protected:
 		}
 	}
 
+	/****************************************************
+	* Population shared by the steady-state workers. The
+	* members are kept in order of total cost, so that
+	* their index is their rank; a member is read through
+	* its shared pointer, which keeps it alive when it is
+	* replaced during a crossover.
+	****************************************************/
+	struct SteadyStatePopulation
+	{
+		std::mutex mtx;
+		vector<std::shared_ptr<const thisChromosomeType>> members;
+		vector<double> alias_probability;	// rank roulette, fixed since index is rank
+		vector<unsigned int> alias_index;
+		unsigned long evaluated=0;	// offspring accepted by the evaluation
+		int step=0;	// generation_step seen by the workers
+		std::atomic<unsigned long> started{0};	// offspring streams handed out
+		std::mutex report_mtx;
+		Chronometer timer;	// since the last report
+		std::atomic<bool> stop{false};
+		StopReason stop_reason=StopReason::Undefined;
+	};
+
+	// Streams of the steady-state offspring, apart from the generation ones
+	uint64_t steady_state_stream(unsigned long ticket) const
+	{
+		return (uint64_t(1)<<63)|uint64_t(ticket);
+	}
+
+	/****************************************************
+	* Steady-state evolution of last_generation: every
+	* worker repeatedly breeds an offspring from the
+	* current members, evaluates it and lets it replace
+	* the worst member if it is better, without waiting
+	* for the others. Each population*crossover_fraction
+	* evaluated offspring count as a generation, reported
+	* from a copy of the members.
+	****************************************************/
+	StopReason solve_steady_state()
+	{
+		if(!rescore_last_generation(true))
+			return StopReason::Deadline;
+		SteadyStatePopulation sp;
+		const vector<thisChromosomeType> &initial=last_generation.chromosomes;
+		sp.members.reserve(initial.size());
+		for(const thisChromosomeType &X:initial)
+			sp.members.push_back(std::make_shared<const thisChromosomeType>(X));
+		std::stable_sort(sp.members.begin(),sp.members.end(),
+			[](const std::shared_ptr<const thisChromosomeType> &a,const std::shared_ptr<const thisChromosomeType> &b)
+			{
+				return a->total_cost<b->total_cost;
+			});
+		vector<double> weights(std::min<size_t>(sp.members.size(),population));
+		for(unsigned int i=0;i<weights.size();i++)
+			weights[i]=1.0/sqrt(double(i+1));
+		build_alias_table(weights,std::accumulate(weights.begin(),weights.end(),0.0),sp.alias_probability,sp.alias_index);
+		sp.step=generation_step;
+		sp.timer.tic();
+
+		if(!multi_threading || N_threads==1)
+			steady_state_worker(sp);
+		else
+		{
+			ThreadPool &pool=worker_pool();
+			function<void(unsigned int,unsigned int)> task=
+				[this,&sp](unsigned int,unsigned int)
+				{
+					steady_state_worker(sp);
+				};
+			if(custom_refresh!=nullptr)
+				pool.parallel_for(pool.size(),task,false,custom_refresh,std::chrono::microseconds(std::max(idle_delay_us,1L)));
+			else
+				pool.parallel_for(pool.size(),task,false);
+		}
+
+		if(sp.stop_reason==StopReason::Undefined && deadline_passed())
+			report_steady_state(sp); // the members evaluated since the last report
+		if(sp.stop_reason==StopReason::Undefined)
+			return stop_critera(); // user request
+		return sp.stop_reason;
+	}
+
+	// Rank of a parent drawn from the members, called under the population lock
+	unsigned int steady_state_parent(const SteadyStatePopulation &sp)
+	{
+		unsigned int N=(unsigned int)sp.members.size();
+		if(tournament_size>0)
+		{ // the best contender has the lowest rank
+			unsigned int winner=N-1;
+			for(unsigned int i=0;i<tournament_size;i++)
+				winner=std::min(winner,std::min((unsigned int)(N*random01()),N-1));
+			return winner;
+		}
+		return alias_draw(sp.alias_probability,sp.alias_index,random01());
+	}
+
+	void steady_state_worker(SteadyStatePopulation &sp)
+	{
+		const unsigned long N_report=std::max(1UL,(unsigned long)std::round(double(population)*crossover_fraction));
+		while(!sp.stop && !user_request_stop && !deadline_passed())
+		{
+			RandomEngine stream(random_seed,steady_state_stream(sp.started++));
+			task_rng()=&stream;
+			double threshold=std::numeric_limits<double>::infinity();
+			auto next_offspring=[this,&sp,&threshold]()
+				{
+					std::shared_ptr<const thisChromosomeType> p1,p2;
+					int step;
+					{
+						std::lock_guard<std::mutex> lock(sp.mtx);
+						unsigned int r1=steady_state_parent(sp),r2=steady_state_parent(sp);
+						while(r1==r2 && sp.members.size()>1)
+							r2=steady_state_parent(sp);
+						p1=sp.members[r1];
+						p2=sp.members[r2];
+						threshold=sp.members.back()->total_cost;
+						step=sp.step;
+					}
+					return breed(p1->genes,p2->genes,step);
+				};
+
+			thisChromosomeType X{next_offspring(),MiddleCostType(),0.0,{}};
+			unique_ptr<thisChromosomeType> Y; // rejected candidate to audit the surrogate with
+			if(surrogate_predict!=nullptr && surrogate_candidates>1)
+				Y=screen_offspring(X.genes,next_offspring);
+			task_rng()=nullptr;
+			bool accepted=(eval_solution_racing!=nullptr)?
+				eval_solution_racing(X.genes,X.middle_costs,threshold):
+				this->eval_solution(X.genes,X.middle_costs);
+			if(!accepted)
+				continue;
+			if(Y && this->eval_solution(Y->genes,Y->middle_costs))
+			{
+				surrogate_audits++;
+				if(calculate_SO_total_fitness(X)<=calculate_SO_total_fitness(*Y))
+					surrogate_hits++;
+			}
+			X.total_cost=calculate_SO_total_fitness(X);
+
+			bool report_due;
+			{
+				std::lock_guard<std::mutex> lock(sp.mtx);
+				if(X.total_cost<sp.members.back()->total_cost)
+				{ // replace the worst member, ties stay behind the current members
+					sp.members.pop_back();
+					auto position=std::upper_bound(sp.members.begin(),sp.members.end(),X.total_cost,
+						[](double cost,const std::shared_ptr<const thisChromosomeType> &member)
+						{
+							return cost<member->total_cost;
+						});
+					sp.members.insert(position,std::make_shared<const thisChromosomeType>(std::move(X)));
+				}
+				report_due=(++sp.evaluated%N_report==0);
+			}
+			if(report_due)
+				report_steady_state(sp);
+		}
+	}
+
+	// Reports a copy of the members as the next generation, the workers carry on meanwhile
+	void report_steady_state(SteadyStatePopulation &sp)
+	{
+		std::lock_guard<std::mutex> report_lock(sp.report_mtx);
+		if(sp.stop || user_request_stop)
+			return ;
+		vector<std::shared_ptr<const thisChromosomeType>> snapshot;
+		{
+			std::lock_guard<std::mutex> lock(sp.mtx);
+			snapshot=sp.members;
+			sp.step=++generation_step;
+		}
+		thisGenerationType generation;
+		generation.chromosomes.reserve(snapshot.size());
+		for(const std::shared_ptr<const thisChromosomeType> &member:snapshot)
+			generation.chromosomes.push_back(*member);
+
+		rank_population(generation);
+		generation.surrogate_audits=surrogate_audits.exchange(0);
+		generation.surrogate_hits=surrogate_hits.exchange(0);
+		take_thread_stats(generation);
+		finalize_generation(generation);
+		generation.exe_time=sp.timer.toc();
+		sp.timer.tic();
+
+		generations_so_abs.push_back(thisGenSOAbs(generation));
+		report_generation(generation);
+		last_generation=std::move(generation);
+		sp.stop_reason=stop_critera();
+		if(sp.stop_reason!=StopReason::Undefined)
+			sp.stop=true;
+		else if(rescore_last_generation(false))
+		{ // the reported members still in the population take their new costs, the offspring since have them already
+			std::unordered_map<const thisChromosomeType*,unsigned int> reported;
+			for(unsigned int i=0;i<snapshot.size();i++)
+				reported[snapshot[i].get()]=i;
+			std::lock_guard<std::mutex> lock(sp.mtx);
+			for(std::shared_ptr<const thisChromosomeType> &member:sp.members)
+			{
+				auto found=reported.find(member.get());
+				if(found!=reported.end())
+					member=std::make_shared<const thisChromosomeType>(last_generation.chromosomes[found->second]);
+			}
+			std::stable_sort(sp.members.begin(),sp.members.end(),
+				[](const std::shared_ptr<const thisChromosomeType> &a,const std::shared_ptr<const thisChromosomeType> &b)
+				{
+					return a->total_cost<b->total_cost;
+				});
+		}
+	}
+
 	StopReason stop_critera()
 	{
+		if(deadline_passed())
+			return StopReason::Deadline;
+
 		if(generation_step<2 && !user_request_stop)
 			return StopReason::Undefined;
 
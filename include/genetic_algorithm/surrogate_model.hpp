@@ -0,0 +1,54 @@
+#ifndef SURROGATE_MODEL_HPP
+#define SURROGATE_MODEL_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+// Online ridge regression over fixed-length feature vectors.
+//
+// Observations are buffered by observe() from any thread and only folded into the
+// normal equations by fit(), in a deterministic order, so predictions do not depend
+// on the order in which worker threads finished their evaluations.
+class RidgeSurrogate {
+public:
+    RidgeSurrogate(std::size_t n_features = 0, double ridge = 1e-3, double forgetting = 0.9);
+
+    void reset(std::size_t n_features);
+
+    void observe(std::uint64_t key, std::vector<double> features, double target);
+    void fit();
+
+    bool ready() const;
+    double predict(const std::vector<double>& features) const;
+
+    std::size_t n_features() const { return _n_features; }
+    std::size_t n_observations() const { return _n_observations; }
+
+private:
+    struct Observation {
+        std::uint64_t key;
+        std::vector<double> features;
+        double target;
+    };
+
+    std::size_t _n_features;
+    double _ridge;
+    double _forgetting;
+
+    std::vector<double> _xtx; // row-major n_features x n_features
+    std::vector<double> _xty;
+    double _effective_observations = 0;
+    std::size_t _n_observations = 0;
+
+    std::vector<double> _weights;
+    bool _fitted = false;
+
+    std::mutex _pending_mtx;
+    std::vector<Observation> _pending;
+    mutable std::shared_mutex _mtx;
+};
+
+#endif //SURROGATE_MODEL_HPP
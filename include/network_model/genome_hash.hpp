@@ -0,0 +1,75 @@
+#ifndef GENOME_HASH_HPP
+#define GENOME_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+struct Hash128 {
+    std::uint64_t low = 0;
+    std::uint64_t high = 0;
+
+    bool operator==(const Hash128& other) const { return low == other.low && high == other.high; }
+    bool operator!=(const Hash128& other) const { return !(*this == other); }
+};
+
+struct Hash128Hasher {
+    std::size_t operator()(const Hash128& hash) const { return static_cast<std::size_t>(hash.low); }
+};
+
+// Incremental 128-bit hash over 64-bit words (MurmurHash3 x64_128 mixing).
+class Hasher128 {
+public:
+    Hasher128(std::uint64_t seed = 0): _h1(seed), _h2(seed) {}
+
+    Hasher128& add(std::uint64_t word) {
+        std::uint64_t k1 = word * c1;
+        k1 = rotl(k1, 31);
+        k1 *= c2;
+        _h1 ^= k1;
+        _h1 = rotl(_h1, 27);
+        _h1 += _h2;
+        _h1 = _h1*5 + 0x52dce729;
+
+        std::uint64_t k2 = word * c2;
+        k2 = rotl(k2, 33);
+        k2 *= c1;
+        _h2 ^= k2;
+        _h2 = rotl(_h2, 31);
+        _h2 += _h1;
+        _h2 = _h2*5 + 0x38495ab5;
+
+        ++_length;
+        return *this;
+    }
+
+    Hash128 finish() const {
+        std::uint64_t h1 = _h1 ^ _length, h2 = _h2 ^ _length;
+        h1 += h2;
+        h2 += h1;
+        h1 = fmix(h1);
+        h2 = fmix(h2);
+        h1 += h2;
+        h2 += h1;
+        return Hash128{h1, h2};
+    }
+
+private:
+    static constexpr std::uint64_t c1 = 0x87c37b91114253d5ULL;
+    static constexpr std::uint64_t c2 = 0x4cf5ad432745937fULL;
+
+    std::uint64_t _h1, _h2;
+    std::uint64_t _length = 0;
+
+    static std::uint64_t rotl(std::uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+    static std::uint64_t fmix(std::uint64_t k) {
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdULL;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ULL;
+        k ^= k >> 33;
+        return k;
+    }
+};
+
+#endif //GENOME_HASH_HPP
@@ -20,6 +20,9 @@ struct SwapPair {
 
     std::string to_string() const;
 
+    // Interface numbers packed with the lower one first; both orientations give the same key.
+    std::uint64_t canonical_key() const;
+
 };
 
 class Swap{
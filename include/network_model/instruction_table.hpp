@@ -14,13 +14,23 @@ class TimeSlot {
 public:
 
     TimeSlot(Node* context, const std::vector<SwapPair>& swap_instructions);
+    // Same swaps as `other`, on the interfaces with the same numbers in `context`
+    TimeSlot(Node* context, const TimeSlot& other);
 
     ~TimeSlot() = default;
 
     void execute_swaps();
     void execute_stores(std::uint32_t time_slot_duration_nanoseconds);
 
-    void mutate(const std::function<double(void)>& rnd01);
+    // rnd01() draws uniformly in [0,1); defined in node.hpp, where Node is complete
+    template<typename Random01>
+    void mutate(const Random01& rnd01);
+
+    // Orients every swap lower interface first and sorts swaps and stores by interface.
+    void canonicalize();
+
+    // Sorted canonical keys of the swaps, equal for slots that differ only in orientation or order.
+    std::vector<std::uint64_t> canonical_keys() const;
 
     bool operator==(const TimeSlot& other) const {
         return _context == other._context
@@ -31,7 +41,8 @@ public:
     void print() const;
 
     Node* context() const { return _context; }
-    std::vector<Swap> swap_instructions() const { return _swap_instructions; }
+    const std::vector<Swap>& swap_instructions() const { return _swap_instructions; }
+    const std::vector<Store>& store_instructions() const { return _store_instructions; }
 
 private:
     Node* _context;
@@ -45,21 +56,28 @@ public:
     InstructionTable() = default;
     
     void set_instruction_table(Node* context, nlohmann::json time_slots);
+    void set_instruction_table(Node* context, const InstructionTable& other);
 
     ~InstructionTable() = default;
 
     void execute_swaps_next_time_slot();
     void execute_stores_next_time_slot(std::uint32_t time_slot_duration_nanoseconds);
 
-    void mutate(const std::function<double(void)>& rnd01);
+    // Defined in node.hpp as well
+    template<typename Random01>
+    void mutate(const Random01& rnd01);
 
     void reset(const std::vector<TimeSlot>& new_time_slots);
+    void replace_time_slot(std::size_t n, const TimeSlot& time_slot);
+
+    // Canonicalizes every slot, keeps the first `period` slots and rotates them left by `rotation`.
+    void canonicalize(std::size_t period, std::size_t rotation);
 
     void print() const;
 
     Node* context() const { return _context; }
 
-    std::vector<TimeSlot> time_slots() { return _time_slots; }
+    const std::vector<TimeSlot>& time_slots() const { return _time_slots; }
 private:
     Node* _context;
     std::vector<TimeSlot> _time_slots;
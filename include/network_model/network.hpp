@@ -1,6 +1,7 @@
 #ifndef NETWORK_HPP
 #define NETWORK_HPP
 
+#include "network_model/genome_hash.hpp"
 #include "network_model/node.hpp"
 
 #include <memory>
@@ -35,6 +36,21 @@ struct LambdaCfg {
     double max_for_lambda;
 };
 
+// Flat arrays a Network can be built from, owned by whoever filled them (a mapped binary
+// file, a streaming parser). Nodes come in the order of the network.
+struct NetworkDescription {
+    std::size_t n_nodes = 0;
+    const char* names = nullptr;                 // node names back to back, names_size bytes
+    std::size_t names_size = 0;
+    const std::uint32_t* name_offsets = nullptr; // n_nodes + 1 offsets into names
+    const std::uint32_t* n_interfaces = nullptr;
+    const double* swap_probabilities = nullptr;
+    std::size_t n_links = 0;
+    const std::uint32_t* links = nullptr;        // node1, interface1, node2, interface2 per link
+    std::size_t n_genome_words = 0;
+    const std::uint32_t* genome = nullptr;       // as Network::encode_instruction_tables
+};
+
 extern std::string network_topology_config_file;
 
 class Network {
@@ -42,25 +58,44 @@ public:
 
     Network();
     Network(const Network& other);
-    Network(Network&& other) = default;
+    Network(Network&& other);
+    // A JSON configuration or a binary network file (network_binary.hpp)
     Network(const char* config_json_file);
     Network(nlohmann::json config_json);
+    Network(const NetworkDescription& description);
 
     ~Network() = default;
 
     Network& operator=(const Network& other);
+    Network& operator=(Network&& other);
 
-    void init_network_random_instruction_tables(const std::function<double(void)>& rnd01);
+    template<typename Random01>
+    void init_network_random_instruction_tables(const Random01& rnd01);
 
     void add_shared_entanglement(NodePair&& node_pair, double entanglement) const;
     void advance_n_time_slots(std::size_t n) const;
     void reset() const;
 
-    void mutate(const std::function<double(void)>& rnd01);
+    template<typename Random01>
+    void mutate(const Random01& rnd01);
+
+    // Crossover on the genome in place: `other` has the same topology and its nodes are
+    // taken by index, the instructions rebound to the interfaces of this network.
+    void copy_instruction_table(std::size_t node, const Network& other);
+    void copy_time_slot(std::size_t node, std::size_t n, const Network& other, std::size_t other_n);
+
+    // Rewrites the instruction tables into the canonical representative of their symmetry
+    // class: swap orientation and order inside a slot, repetitions of a shorter cycle and
+    // a rotation applied to every node at once do not change the schedule.
+    void canonicalize();
 
     void print() const;
 
     std::vector<NodePair> pairs() const { return _node_pairs; }
+    const std::vector<std::unique_ptr<Node>>& nodes() const { return _nodes; }
+
+    LambdaCfg pair_weight(const NodePair& pair) const { return _node_pair_weight.at(pair); }
+    std::uint32_t time_slots_duration_nanoseconds() const { return _time_slots_duration_nanoseconds; }
 
     double pair_shared_entanglement(const NodePair& pair) const { return _shared_entanglement.at(pair); }
     double amount_entanglement() const;
@@ -68,6 +103,15 @@ public:
 
     nlohmann::json to_json() const;
 
+    // Instruction tables as 32-bit words: for every node its number of time slots, then for
+    // every slot its number of swaps followed by the interface numbers of each swap.
+    void encode_instruction_tables(std::vector<std::uint32_t>& words) const;
+    // Replaces the instruction tables by encoded ones, of a network of the same topology
+    void decode_instruction_tables(const std::uint32_t* words, std::size_t n_words);
+
+    // Hash of the canonical instruction tables, identical for equivalent genomes.
+    Hash128 genome_hash() const;
+
 private:
     std::vector<std::unique_ptr<Node>> _nodes;
 
@@ -79,6 +123,50 @@ private:
     std::uint32_t _time_slots_duration_nanoseconds = 1e6;
 
     void compute_next_time_slot() const;
+
+    struct CanonicalForm {
+        std::vector<std::vector<std::vector<std::uint64_t>>> slot_keys; // per node, per slot
+        std::vector<std::size_t> periods;
+        std::vector<std::size_t> rotations;
+    };
+    CanonicalForm canonical_form() const;
 };
 
+template<typename Random01>
+void Network::init_network_random_instruction_tables(const Random01& rnd01) {
+    for (std::unique_ptr<Node>& node : _nodes) {
+        std::size_t n_time_slots = static_cast<std::size_t>(rnd01() * 9) + 1;
+        std::vector<TimeSlot> time_slots;
+        time_slots.reserve(n_time_slots);
+        
+        for (std::size_t i_time_slot = 0; i_time_slot < n_time_slots; ++i_time_slot) {
+            std::vector<std::shared_ptr<EntanglementInterface>> interfaces = node->get_interfaces();
+            std::vector<SwapPair> swap_instructions;
+
+            while (interfaces.size() > 1) {
+                std::size_t interface_n = static_cast<std::size_t>(rnd01() * interfaces.size());
+                std::shared_ptr<EntanglementInterface> interface = interfaces[interface_n];
+                interfaces.erase(std::find(interfaces.begin(), interfaces.end(), interface));
+                if (rnd01() > 0.3) { //We create a Swap
+                    std::shared_ptr<EntanglementInterface> interface2 = interfaces[static_cast<std::size_t>(rnd01() * interfaces.size())];
+                    interfaces.erase(std::find(interfaces.begin(), interfaces.end(), interface2));
+                    swap_instructions.push_back(SwapPair(interface, interface2));
+                }
+            }
+
+            time_slots.push_back(TimeSlot(node.get(), swap_instructions));
+        }
+
+        node->reset_instruction_table(time_slots);
+    }
+}
+
+template<typename Random01>
+void Network::mutate(const Random01& rnd01) {
+    for (std::unique_ptr<Node>& node : _nodes) {
+        if (rnd01() < 0.8)
+            node->mutate(rnd01);
+    }
+}
+
 #endif //NETWORK_HPP
\ No newline at end of file
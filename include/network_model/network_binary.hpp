@@ -0,0 +1,36 @@
+#ifndef NETWORK_BINARY_HPP
+#define NETWORK_BINARY_HPP
+
+#include "network_model/network.hpp"
+
+#include <cstddef>
+
+// Binary network file: a 48-byte header followed by the arrays of a NetworkDescription
+// (swap probabilities, name offsets, interface counts, links, instruction table words and
+// names), each starting on an 8-byte boundary, in the byte order of the machine that wrote
+// it. The file is mapped read-only and its arrays are used in place, without parsing.
+class NetworkBinaryFile {
+public:
+    static constexpr std::uint32_t version = 1;
+
+    // Maps the file and checks that its header and arrays fit it
+    explicit NetworkBinaryFile(const char* path);
+    NetworkBinaryFile(const NetworkBinaryFile&) = delete;
+    NetworkBinaryFile& operator=(const NetworkBinaryFile&) = delete;
+    ~NetworkBinaryFile();
+
+    // Valid while the file is mapped
+    const NetworkDescription& description() const { return _description; }
+
+    // Whether the file starts like a binary network file, of any version
+    static bool is_binary(const char* path);
+    // Topology and instruction tables of network, replacing any file at path
+    static void write(const char* path, const Network& network);
+
+private:
+    void* _data = nullptr;
+    std::size_t _size = 0;
+    NetworkDescription _description;
+};
+
+#endif //NETWORK_BINARY_HPP
@@ -0,0 +1,59 @@
+#ifndef NETWORK_JSON_READER_HPP
+#define NETWORK_JSON_READER_HPP
+
+#include "network_model/network.hpp"
+
+#include <istream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Streams a JSON network configuration into the flat arrays of a NetworkDescription
+// without building the JSON document. Node names are interned as they appear, in links
+// or in nodes, and every link is kept as a pair of node indices. Once the input ends the
+// nodes are sorted by name and links in key order, a repeated key keeping its last value,
+// as Network(nlohmann::json) sees them.
+class NetworkJsonReader {
+public:
+    // Throws on a malformed configuration. Valid until the next call.
+    const NetworkDescription& read(std::istream& input);
+
+private:
+    class Handler; // SAX events
+
+    struct ParsedNode {
+        std::string name;
+        bool defined = false;
+        bool has_interfaces = false;
+        bool has_swap_probability = false;
+        std::uint32_t n_interfaces = 0;
+        double swap_probability = 0;
+        std::vector<std::uint32_t> instruction_table; // as Network::encode_instruction_tables
+    };
+
+    struct ParsedLink {
+        std::string key;
+        std::uint32_t node1;
+        std::uint32_t node2;
+        std::uint32_t interface1 = 0;
+        std::uint32_t interface2 = 0;
+        bool has_interfaces = false;
+    };
+
+    std::vector<ParsedNode> _nodes;
+    std::unordered_map<std::string, std::uint32_t> _node_index;
+    std::vector<ParsedLink> _links;
+
+    std::string _names;
+    std::vector<std::uint32_t> _name_offsets;
+    std::vector<std::uint32_t> _n_interfaces;
+    std::vector<double> _swap_probabilities;
+    std::vector<std::uint32_t> _link_words;
+    std::vector<std::uint32_t> _genome;
+    NetworkDescription _description;
+
+    std::uint32_t intern(const std::string& name);
+    void describe();
+};
+
+#endif //NETWORK_JSON_READER_HPP
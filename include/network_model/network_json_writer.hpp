@@ -0,0 +1,38 @@
+#ifndef NETWORK_JSON_WRITER_HPP
+#define NETWORK_JSON_WRITER_HPP
+
+#include "network_model/network.hpp"
+
+#include <string>
+#include <vector>
+
+// Writes the text of Network::to_json().dump() straight into a buffer kept between
+// calls, without building the JSON document: keys in the same sorted order, a link
+// stored once from the end met first, empty time slots as null.
+class NetworkJsonWriter {
+public:
+    // Valid until the next call
+    const std::string& write(const Network& network);
+
+private:
+    // Keyed "node1-node2" like the links of the document
+    struct Link {
+        const Node* node1;
+        const Node* node2;
+        std::size_t interface1;
+        std::size_t interface2;
+        std::size_t met; // position in the order to_json meets the links
+    };
+
+    std::string _buffer;
+    std::vector<const Node*> _sorted_nodes;
+    std::vector<Link> _links; // every interface's link while collecting them, then the document's sorted by key
+
+    void collect_links(const Network& network);
+
+    void write_string(const std::string& value);
+    void write_unsigned(std::size_t value);
+    void write_double(double value);
+};
+
+#endif //NETWORK_JSON_WRITER_HPP
@@ -5,6 +5,7 @@
 
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 #include <string>
@@ -20,16 +21,26 @@ public:
     Node(Network* network, std::string name): _node_name(name), _network(network) {}
 
     void initialize_node(nlohmann::json node_config);
+    // Same interfaces, swap probability and instruction table as `other`, without links
+    void initialize_node(const Node& other);
+    // Interfaces and swap probability only, with an empty instruction table
+    void initialize_node(std::size_t n_interfaces, double swap_probability);
 
     void reset_instruction_table(const std::vector<TimeSlot>& time_slots);
+    // Instruction table, or one of its slots, taken from the same node in a network of the same topology
+    void copy_instruction_table(const Node& other);
+    void copy_time_slot(std::size_t n, const Node& other, std::size_t other_n);
+    void canonicalize_instruction_table(std::size_t period, std::size_t rotation);
 
     void compute_next_time_slot(std::uint32_t time_slot_duration_nanoseconds);
 
-    void mutate(const std::function<double(void)>& rnd01);
+    template<typename Random01>
+    void mutate(const Random01& rnd01) { _instruction_table.mutate(rnd01); }
 
     void print() const;
     
     Network* network() const { return _network; }
+    void rebind_network(Network* network) { _network = network; } // after the owning Network moved
 
     std::vector<std::shared_ptr<EntanglementInterface>> get_interfaces() const;
     std::size_t n_interfaces() const { return _entanglement_interfaces.size(); }
@@ -38,7 +49,7 @@ public:
     std::uint32_t expected_swaps_per_nanosecond() const { return _expected_swaps_per_nanosecond; }
     double swap_probability() const { return _swap_probability; }
 
-    std::vector<TimeSlot> time_slots() { return _instruction_table.time_slots(); }
+    const std::vector<TimeSlot>& time_slots() const { return _instruction_table.time_slots(); }
 
     std::shared_ptr<EntanglementInterface> operator[](std::size_t n) { return _entanglement_interfaces[n]; }
 
@@ -54,4 +65,97 @@ private:
     double _swap_probability = 0.5;
 };
 
+// Mutation of the instruction tables, which needs Node
+template<typename Random01>
+void TimeSlot::mutate(const Random01& rnd01) {
+    if (_context->n_interfaces() < 2) return;
+
+    double action = rnd01();
+    if (action < 0.333) {
+        //Change one swap for two stores
+        if (_swap_instructions.size() < 1) return;
+
+        Swap& swap_to_change = _swap_instructions[static_cast<std::size_t>(rnd01()*_swap_instructions.size())];
+        _swap_instructions.erase(
+            std::find(
+                _swap_instructions.begin(), _swap_instructions.end(), swap_to_change
+            )
+        );
+        _store_instructions.push_back(Store(swap_to_change.swap_pair().e1));
+        _store_instructions.push_back(Store(swap_to_change.swap_pair().e2));
+    } else if (action < 0.666) {
+        //Change two stores for one swap
+        if (_store_instructions.size() < 2) return;
+        Store store1 = _store_instructions[static_cast<std::size_t>(rnd01()*_store_instructions.size())];
+        _store_instructions.erase(
+            std::find(
+                _store_instructions.begin(), _store_instructions.end(), store1
+            )
+        );
+        Store store2 = _store_instructions[static_cast<std::size_t>(rnd01()*_store_instructions.size())];
+        _store_instructions.erase(
+            std::find(
+                _store_instructions.begin(), _store_instructions.end(), store2
+            )
+        );
+        _swap_instructions.push_back(Swap(SwapPair(store1.interface().lock(), store2.interface().lock())));
+    } else {
+        //Mix two swaps
+        if (_swap_instructions.size() < 2) return;
+        Swap swap1 = _swap_instructions[static_cast<std::size_t>(rnd01()*_swap_instructions.size())];
+        _swap_instructions.erase(
+            std::find(
+                _swap_instructions.begin(), _swap_instructions.end(), swap1
+            )
+        );
+        Swap swap2 = _swap_instructions[static_cast<std::size_t>(rnd01()*_swap_instructions.size())];
+        _swap_instructions.erase(
+            std::find(
+                _swap_instructions.begin(), _swap_instructions.end(), swap2
+            )
+        );
+        if (rnd01() > 0.5) {
+            _swap_instructions.push_back(Swap(SwapPair(swap1.swap_pair().e1.lock(), swap2.swap_pair().e1.lock())));
+            _swap_instructions.push_back(Swap(SwapPair(swap1.swap_pair().e2.lock(), swap2.swap_pair().e2.lock())));
+        } else {
+            _swap_instructions.push_back(Swap(SwapPair(swap1.swap_pair().e1.lock(), swap2.swap_pair().e2.lock())));
+            _swap_instructions.push_back(Swap(SwapPair(swap1.swap_pair().e2.lock(), swap2.swap_pair().e1.lock())));
+        }
+    }
+}
+
+template<typename Random01>
+void InstructionTable::mutate(const Random01& rnd01) {
+    double action = rnd01();
+    if (action < 0.4) {
+        //Mutate time_slots
+        for (TimeSlot& time_slot : _time_slots)
+            if (rnd01() < 0.2)
+                time_slot.mutate(rnd01);
+    } else if (action < 0.7) {
+        //Add a new random time slot
+        std::vector<SwapPair> swap_instructions;
+        std::vector<std::shared_ptr<EntanglementInterface>> interfaces = _context->get_interfaces();
+
+        while (interfaces.size() > 1) {
+            std::shared_ptr<EntanglementInterface> interface = interfaces[static_cast<std::size_t>(rnd01() * interfaces.size())];
+            interfaces.erase(std::find(interfaces.begin(), interfaces.end(), interface));
+            if (rnd01() > 0.5) { //We create a Swap
+                std::shared_ptr<EntanglementInterface> interface2 = interfaces[static_cast<std::size_t>(rnd01() * interfaces.size())];
+                interfaces.erase(std::find(interfaces.begin(), interfaces.end(), interface2));
+                swap_instructions.push_back(SwapPair(interface, interface2));
+            }
+        }
+
+        _time_slots.push_back(TimeSlot(_context, swap_instructions));
+    } else {
+        //We erase a time slot at random
+        if (_time_slots.size() == 1) {
+            _time_slots.clear();
+            _time_slots.push_back(TimeSlot(_context, std::vector<SwapPair>()));
+        } else 
+            _time_slots.erase(std::find(_time_slots.begin(), _time_slots.end(), _time_slots[static_cast<std::size_t>(rnd01() * _time_slots.size())]));
+    }
+}
+
 #endif //NODE_HPP
\ No newline at end of file
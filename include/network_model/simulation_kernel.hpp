@@ -0,0 +1,293 @@
+#ifndef SIMULATION_KERNEL_HPP
+#define SIMULATION_KERNEL_HPP
+
+#include "network_model/genome_hash.hpp"
+#include "network_model/network.hpp"
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef STATIC_TOPOLOGY_KERNEL
+#include "static_topology.hpp"
+#endif
+
+// Flat view of a Network topology: nodes, interfaces and pairs are plain indices
+// following the order of Network::nodes() and Network::pairs().
+class RuntimeTopology {
+public:
+    static constexpr std::uint32_t no_pair = 0xffffffff;
+
+    template<typename T> using node_array = std::vector<T>;
+    template<typename T> using interface_array = std::vector<T>;
+    template<typename T> using pair_array = std::vector<T>;
+
+    RuntimeTopology(const Network& network);
+
+    std::size_t n_nodes() const { return _node_names.size(); }
+    std::size_t n_interfaces() const { return _interface_node.size(); }
+    std::size_t n_pairs() const { return _pair_lambda.size(); }
+
+    const std::string& node_name(std::size_t node) const { return _node_names[node]; }
+    std::uint32_t interface_offset(std::size_t node) const { return _interface_offset[node]; }
+    std::uint32_t interface_node(std::size_t interface) const { return _interface_node[interface]; }
+    std::uint32_t fibre(std::size_t interface) const { return _fibre[interface]; }
+    double swap_probability(std::size_t node) const { return _swap_probability[node]; }
+    std::uint32_t expected_swaps_per_nanosecond(std::size_t node) const { return _expected_swaps_per_nanosecond[node]; }
+    std::uint32_t time_slot_duration_nanoseconds() const { return _time_slot_duration_nanoseconds; }
+    std::uint32_t pair_index(std::size_t node1, std::size_t node2) const { return _pair_index[node1*n_nodes() + node2]; }
+    double pair_fidelity_capacity(std::size_t pair) const { return _pair_fidelity_capacity[pair]; }
+    LambdaCfg pair_lambda(std::size_t pair) const { return _pair_lambda[pair]; }
+    bool all_swap_probabilities_one() const { return _all_swap_probabilities_one; }
+
+    template<typename T> node_array<T> make_node_array() const { return node_array<T>(n_nodes()); }
+    template<typename T> interface_array<T> make_interface_array() const { return interface_array<T>(n_interfaces()); }
+    template<typename T> pair_array<T> make_pair_array() const { return pair_array<T>(n_pairs()); }
+
+    // Hash of every constant the simulation depends on, used to key stored fitness values.
+    Hash128 hash() const;
+
+    // Writes a header with this topology as compile-time constants, see StaticTopology.
+    void write_static_topology_header(std::ostream& os, const std::string& source_name) const;
+
+private:
+    std::vector<std::string> _node_names;
+    std::vector<std::uint32_t> _interface_offset;
+    std::vector<std::uint32_t> _interface_node;
+    std::vector<std::uint32_t> _fibre;
+    std::vector<double> _swap_probability;
+    std::vector<std::uint32_t> _expected_swaps_per_nanosecond;
+    std::uint32_t _time_slot_duration_nanoseconds;
+    std::vector<std::uint32_t> _pair_index;
+    std::vector<double> _pair_fidelity_capacity;
+    std::vector<LambdaCfg> _pair_lambda;
+    bool _all_swap_probabilities_one;
+};
+
+// Same interface as RuntimeTopology, but every size and constant comes from a
+// generated header (see topology_codegen), so the kernel loops get fixed bounds.
+template<typename Generated>
+class StaticTopology {
+public:
+    static constexpr std::uint32_t no_pair = RuntimeTopology::no_pair;
+
+    template<typename T> using node_array = std::array<T, Generated::n_nodes>;
+    template<typename T> using interface_array = std::array<T, Generated::n_interfaces>;
+    template<typename T> using pair_array = std::array<T, Generated::n_pairs>;
+
+    static constexpr std::size_t n_nodes() { return Generated::n_nodes; }
+    static constexpr std::size_t n_interfaces() { return Generated::n_interfaces; }
+    static constexpr std::size_t n_pairs() { return Generated::n_pairs; }
+
+    static constexpr const char* node_name(std::size_t node) { return Generated::node_names[node]; }
+    static constexpr std::uint32_t interface_offset(std::size_t node) { return Generated::interface_offset[node]; }
+    static constexpr std::uint32_t interface_node(std::size_t interface) { return Generated::interface_node[interface]; }
+    static constexpr std::uint32_t fibre(std::size_t interface) { return Generated::fibre[interface]; }
+    static constexpr double swap_probability(std::size_t node) { return Generated::swap_probability[node]; }
+    static constexpr std::uint32_t expected_swaps_per_nanosecond(std::size_t node) { return Generated::expected_swaps_per_nanosecond[node]; }
+    static constexpr std::uint32_t time_slot_duration_nanoseconds() { return Generated::time_slot_duration_nanoseconds; }
+    static constexpr std::uint32_t pair_index(std::size_t node1, std::size_t node2) { return Generated::pair_index[node1*n_nodes() + node2]; }
+    static constexpr double pair_fidelity_capacity(std::size_t pair) { return Generated::pair_fidelity_capacity[pair]; }
+    static constexpr LambdaCfg pair_lambda(std::size_t pair) { return Generated::pair_lambda[pair]; }
+    static constexpr bool all_swap_probabilities_one() { return Generated::all_swap_probabilities_one; }
+
+    template<typename T> static constexpr node_array<T> make_node_array() { return {}; }
+    template<typename T> static constexpr interface_array<T> make_interface_array() { return {}; }
+    template<typename T> static constexpr pair_array<T> make_pair_array() { return {}; }
+
+    static bool matches(const RuntimeTopology& topology) {
+        if (topology.n_nodes() != n_nodes() || topology.n_interfaces() != n_interfaces() || topology.n_pairs() != n_pairs())
+            return false;
+        if (topology.time_slot_duration_nanoseconds() != time_slot_duration_nanoseconds())
+            return false;
+        for (std::size_t node = 0; node < n_nodes(); ++node) {
+            if (topology.node_name(node) != node_name(node)
+             || topology.interface_offset(node) != interface_offset(node)
+             || topology.swap_probability(node) != swap_probability(node)
+             || topology.expected_swaps_per_nanosecond(node) != expected_swaps_per_nanosecond(node))
+                return false;
+            for (std::size_t other = 0; other < n_nodes(); ++other)
+                if (topology.pair_index(node, other) != pair_index(node, other))
+                    return false;
+        }
+        for (std::size_t interface = 0; interface < n_interfaces(); ++interface)
+            if (topology.interface_node(interface) != interface_node(interface) || topology.fibre(interface) != fibre(interface))
+                return false;
+        for (std::size_t pair = 0; pair < n_pairs(); ++pair)
+            if (topology.pair_fidelity_capacity(pair) != pair_fidelity_capacity(pair)
+             || topology.pair_lambda(pair).lambda != pair_lambda(pair).lambda
+             || topology.pair_lambda(pair).max_for_lambda != pair_lambda(pair).max_for_lambda)
+                return false;
+        return true;
+    }
+};
+
+// Instruction tables of a Network flattened into global interface indices.
+struct SimulationSchedule {
+    struct Slot {
+        std::uint32_t swap_begin, swap_end;
+        std::uint32_t store_begin, store_end;
+    };
+
+    std::vector<std::uint32_t> swaps; // consecutive (e1, e2) interface pairs
+    std::vector<std::uint32_t> stores;
+    std::vector<Slot> slots;
+    std::vector<std::uint32_t> node_slot_begin; // n_nodes + 1 entries
+
+    SimulationSchedule(const Network& network, const RuntimeTopology& topology);
+
+    // Compact form exchanged with evaluation worker processes: the four array sizes,
+    // then node_slot_begin, slots, swaps and stores, all as 32-bit words.
+    void encode(std::vector<std::uint32_t>& words) const;
+    SimulationSchedule(const std::uint32_t* words, std::size_t n_words);
+};
+
+// Reproduces Network::advance_n_time_slots/amount_entanglement/reset on flat arrays.
+template<typename Topology>
+class SimulationKernel {
+public:
+    SimulationKernel(const Topology& topology, const SimulationSchedule& schedule):
+        _topology(topology),
+        _schedule(schedule),
+        _next_time_slot(topology.template make_node_array<std::uint32_t>()),
+        _entangled_pair(topology.template make_interface_array<std::uint32_t>()),
+        _still_entangled_probability(topology.template make_interface_array<double>()),
+        _shared_entanglement(topology.template make_pair_array<double>()) {
+        for (std::size_t node = 0; node < _topology.n_nodes(); ++node)
+            _next_time_slot[node] = 0;
+        for (std::size_t interface = 0; interface < _topology.n_interfaces(); ++interface) {
+            _entangled_pair[interface] = _topology.fibre(interface);
+            _still_entangled_probability[interface] = 1;
+        }
+        reset();
+    }
+
+    void advance_n_time_slots(std::size_t n) {
+        for (std::size_t i = 0; i < n; ++i)
+            compute_next_time_slot();
+    }
+
+    void reset() {
+        for (std::size_t pair = 0; pair < _topology.n_pairs(); ++pair)
+            _shared_entanglement[pair] = 0;
+    }
+
+    double pair_shared_entanglement(std::size_t pair) const { return _shared_entanglement[pair]; }
+
+    double amount_entanglement() const {
+        double amount_of_entanglement = 0;
+        for (std::size_t pair = 0; pair < _topology.n_pairs(); ++pair)
+            amount_of_entanglement += pair_amount_entanglement(pair);
+        return amount_of_entanglement;
+    }
+
+    // Share of amount_entanglement() of one pair, in the order of Network::pairs()
+    double pair_amount_entanglement(std::size_t pair) const {
+        double shared_entanglement = _shared_entanglement[pair];
+        if (shared_entanglement <= 0.0) return 0.0;
+        LambdaCfg lambda_cfg = _topology.pair_lambda(pair);
+        return exp(-lambda_cfg.lambda)*pow(lambda_cfg.lambda, shared_entanglement) / (std::tgamma(shared_entanglement) * lambda_cfg.max_for_lambda);
+    }
+
+private:
+    const Topology& _topology;
+    const SimulationSchedule& _schedule;
+    typename Topology::template node_array<std::uint32_t> _next_time_slot;
+    typename Topology::template interface_array<std::uint32_t> _entangled_pair;
+    typename Topology::template interface_array<double> _still_entangled_probability;
+    typename Topology::template pair_array<double> _shared_entanglement;
+
+    void compute_next_time_slot() {
+        for (std::size_t pair = 0; pair < _topology.n_pairs(); ++pair)
+            _shared_entanglement[pair] *= _topology.pair_fidelity_capacity(pair);
+
+        for (std::size_t node = 0; node < _topology.n_nodes(); ++node) {
+            std::uint32_t first_slot = _schedule.node_slot_begin[node];
+            std::uint32_t n_slots = _schedule.node_slot_begin[node + 1] - first_slot;
+            const SimulationSchedule::Slot& slot = _schedule.slots[first_slot + _next_time_slot[node]];
+
+            for (std::uint32_t i = slot.swap_begin; i < slot.swap_end; i += 2)
+                execute_swap(_schedule.swaps[i], _schedule.swaps[i + 1]);
+
+            for (std::uint32_t i = slot.store_begin; i < slot.store_end; ++i)
+                execute_store(node, _schedule.stores[i]);
+
+            if (++_next_time_slot[node] >= n_slots)
+                _next_time_slot[node] = 0;
+
+            for (std::uint32_t interface = _topology.interface_offset(node); interface < _topology.interface_offset(node + 1); ++interface) {
+                _entangled_pair[interface] = _topology.fibre(interface);
+                _still_entangled_probability[interface] = 1;
+            }
+        }
+    }
+
+    void execute_swap(std::uint32_t e1, std::uint32_t e2) {
+        std::uint32_t e1_pair = _entangled_pair[e1], e2_pair = _entangled_pair[e2];
+
+        _entangled_pair[e1] = e2;
+        _entangled_pair[e2] = e1;
+        _entangled_pair[e1_pair] = e2_pair;
+        _entangled_pair[e2_pair] = e1_pair;
+
+        _still_entangled_probability[e1] = 0;
+        _still_entangled_probability[e2] = 0;
+
+        if (_topology.all_swap_probabilities_one()) return;
+        _still_entangled_probability[e1_pair] *= _topology.swap_probability(_topology.interface_node(e1_pair));
+        _still_entangled_probability[e2_pair] *= _topology.swap_probability(_topology.interface_node(e2_pair));
+    }
+
+    void execute_store(std::size_t node, std::uint32_t e) {
+        std::uint32_t pair = _topology.pair_index(node, _topology.interface_node(_entangled_pair[e]));
+        if (pair == Topology::no_pair) return;
+        double entanglement = _still_entangled_probability[e] * _topology.expected_swaps_per_nanosecond(node) * _topology.time_slot_duration_nanoseconds();
+        _shared_entanglement[pair] += entanglement/(2e9);
+    }
+};
+
+// Runs function(kernel) with the generated kernel when the topology matches the one
+// compiled in with STATIC_TOPOLOGY_KERNEL, and the generic one otherwise.
+template<typename Function>
+void with_simulation_kernel(const RuntimeTopology& topology, const SimulationSchedule& schedule, Function&& function) {
+#ifdef STATIC_TOPOLOGY_KERNEL
+    if (StaticTopology<GeneratedTopology>::matches(topology)) {
+        StaticTopology<GeneratedTopology> static_topology;
+        SimulationKernel<StaticTopology<GeneratedTopology>> kernel(static_topology, schedule);
+        function(kernel);
+        return;
+    }
+#endif
+    SimulationKernel<RuntimeTopology> kernel(topology, schedule);
+    function(kernel);
+}
+
+template<typename Function>
+void with_simulation_kernel(const Network& network, Function&& function) {
+    RuntimeTopology topology(network);
+    SimulationSchedule schedule(network, topology);
+    with_simulation_kernel(topology, schedule, std::forward<Function>(function));
+}
+
+inline bool static_topology_kernel_enabled() {
+#ifdef STATIC_TOPOLOGY_KERNEL
+    return true;
+#else
+    return false;
+#endif
+}
+
+inline bool static_topology_matches(const Network& network) {
+#ifdef STATIC_TOPOLOGY_KERNEL
+    return StaticTopology<GeneratedTopology>::matches(RuntimeTopology(network));
+#else
+    (void) network;
+    return false;
+#endif
+}
+
+#endif //SIMULATION_KERNEL_HPP
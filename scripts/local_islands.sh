@@ -0,0 +1,44 @@
+#!/bin/sh
+# Runs N optimizer processes on this machine as the islands of one model, linked by Unix sockets.
+#
+#   scripts/local_islands.sh N [optimization binary] [extra options...]
+#
+# Island i runs in its own directory under $ISLANDS_DIR (a new temporary directory by default)
+# with seed $SEED+i, listens on island_i.sock there and sends its migrants to every other island.
+# Islands started late, or restarted, join the exchange at their next migration.
+set -e
+
+n_islands=${1:?usage: $0 N [optimization binary] [extra options...]}
+shift
+binary=$(realpath "${1:-./optimization}")
+[ $# -gt 0 ] && shift
+seed=${SEED:-1}
+topology=$(realpath "${TOPOLOGY:-$(dirname "$0")/../network_config/star_topology.json}")
+dir=${ISLANDS_DIR:-$(mktemp -d)}
+
+pids=""
+i=0
+while [ "$i" -lt "$n_islands" ]; do
+    mkdir -p "$dir/island_$i"
+    peers=""
+    j=0
+    while [ "$j" -lt "$n_islands" ]; do
+        [ "$j" -ne "$i" ] && peers="$peers --peer unix:$dir/island_$j.sock"
+        j=$((j + 1))
+    done
+    (cd "$dir/island_$i" && exec "$binary" --seed $((seed + i)) --topology "$topology" \
+        --listen "unix:$dir/island_$i.sock" $peers "$@" > output.txt 2>&1) &
+    pids="$pids $!"
+    i=$((i + 1))
+done
+
+echo "Islands running in $dir"
+for pid in $pids; do
+    wait "$pid" || true
+done
+
+i=0
+while [ "$i" -lt "$n_islands" ]; do
+    echo "Island $i: $(grep -c '^Generation' "$dir/island_$i/output.txt") generations, $(grep '^Generation' "$dir/island_$i/output.txt" | tail -n 1)"
+    i=$((i + 1))
+done
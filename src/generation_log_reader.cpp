@@ -0,0 +1,71 @@
+#include "genetic_algorithm/generation_log.hpp"
+#include "network_model/network.hpp"
+#include "network_model/network_json_writer.hpp"
+#include "network_model/simulation_kernel.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+std::string network_topology_config_file;
+
+// Converts a generation log to TSV (one row per generation, the best genome as its JSON
+// configuration) or to a JSON array, on standard output.
+int main(int argc, char** argv) {
+    bool json_output = argc == 4 && std::string(argv[3]) == "--json";
+    if (argc != 3 && !json_output) {
+        std::cerr << "Usage: " << argv[0] << " <generation_log.bin> <topology.json> [--json]\n";
+        return 1;
+    }
+    network_topology_config_file = argv[2];
+
+    Hash128 topology_hash;
+    std::vector<GenerationLog::Snapshot> snapshots;
+    try {
+        snapshots = GenerationLog::read(argv[1], topology_hash);
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    Network network(argv[2]);
+    if (RuntimeTopology(network).hash() != topology_hash) {
+        std::cerr << argv[1] << " was written for another topology than " << argv[2] << "\n";
+        return 1;
+    }
+
+    NetworkJsonWriter json_writer;
+    nlohmann::json generations = nlohmann::json::array();
+    std::cout << std::setprecision(std::numeric_limits<double>::max_digits10);
+    if (!json_output)
+        std::cout << "generation\tbest\taverage\texe_time\tbest_genes\n";
+    for (const GenerationLog::Snapshot& snapshot : snapshots) {
+        try {
+            network.decode_instruction_tables(snapshot.genome.data(), snapshot.genome.size());
+        } catch (const char* e) {
+            std::cerr << "Generation " << snapshot.generation << ": " << e << "\n";
+            return 1;
+        }
+        if (json_output)
+            generations.push_back({
+                {"generation", snapshot.generation},
+                {"best", snapshot.best},
+                {"average", snapshot.average},
+                {"exe_time", snapshot.exe_time},
+                {"best_genes", network.to_json()}
+            });
+        else
+            std::cout
+                << snapshot.generation << "\t"
+                << snapshot.best << "\t"
+                << snapshot.average << "\t"
+                << snapshot.exe_time << "\t"
+                << json_writer.write(network) << "\n";
+    }
+    if (json_output)
+        std::cout << generations.dump() << "\n";
+
+    return 0;
+}
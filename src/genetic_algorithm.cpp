@@ -3,73 +3,244 @@
 
 std::string network_topology_config_file = "../network_config/star_topology.json";
 
-int main(void) {
+int main(int argc, char** argv) {
     
     std::string config_file_name;
 
-    output_file.open("./result.txt");
-	output_file
-		<<"step"<<"\t"
-		<<"cost_avg"<<"\t"
-		<<"cost_best"<<"\t"
-		<<"x_best0"<<"\t"
-		<<"x_best1"<<"\t"
-		<<"x_best2"<<"\t"
-		<<"x_best3"<<"\t"
-		<<"x_best4"
-		<<"\n";
+    bool seed_given = false, steady_state = false, pin_threads = false, multi_objective = false;
+    std::uint64_t seed = 0;
+    std::size_t n_eval_workers = 0;
+    double time_limit = 0;
+    unsigned int n_islands = 1;
+    unsigned int migration_interval = 5;
+    EA::MigrationTopology migration_topology = EA::MigrationTopology::Ring;
+    std::string listen_address;
+    std::vector<std::string> peer_addresses;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		bool has_value = i + 1 < argc;
+		if (arg == "--seed" && has_value) {
+			seed = std::stoull(argv[++i]);
+			seed_given = true;
+		} else if (arg == "--topology" && has_value)
+			network_topology_config_file = argv[++i];
+		else if (arg == "--eval-workers" && has_value)
+			n_eval_workers = std::stoul(argv[++i]);
+		else if (arg == "--steady-state")
+			steady_state = true;
+		else if (arg == "--pin-threads")
+			pin_threads = true;
+		else if (arg == "--multi-objective")
+			multi_objective = true;
+		else if (arg == "--time-limit" && has_value)
+			time_limit = std::stod(argv[++i]);
+		else if (arg == "--slot-crossover" && has_value)
+			time_slot_crossover_rate = std::stod(argv[++i]);
+		else if (arg == "--islands" && has_value)
+			n_islands = std::stoul(argv[++i]);
+		else if (arg == "--migration-interval" && has_value)
+			migration_interval = std::max(1ul, std::stoul(argv[++i]));
+		else if (arg == "--migration-topology" && has_value)
+			migration_topology = std::string(argv[++i]) == "random"? EA::MigrationTopology::Random : EA::MigrationTopology::Ring;
+		else if (arg == "--listen" && has_value)
+			listen_address = argv[++i];
+		else if (arg == "--peer" && has_value)
+			peer_addresses.push_back(argv[++i]);
+		else {
+			std::cout << "Unknown option " << arg << std::endl;
+			return 1;
+		}
+	}
+	bool networked = !listen_address.empty() || !peer_addresses.empty();
+	if (networked && (n_islands > 1 || steady_state)) {
+		std::cout << "--listen and --peer need a single generational population." << std::endl;
+		return 1;
+	}
+	if (multi_objective && (networked || n_islands > 1 || steady_state)) {
+		std::cout << "--multi-objective needs a single generational population." << std::endl;
+		return 1;
+	}
+
+	Hash128 topology_hash = RuntimeTopology(Network(network_topology_config_file.c_str())).hash();
+	try {
+		fitness_store.open("./fitness_db.bin", topology_hash);
+		std::cout << "Fitness store: " << fitness_store.loaded_records() << " evaluations loaded from previous runs." << std::endl;
+	} catch (const std::runtime_error& e) {
+		std::cout << e.what() << ", running without fitness store." << std::endl;
+	}
+
+	if (static_topology_kernel_enabled() && !static_topology_matches(Network(network_topology_config_file.c_str())))
+		std::cout << "The static simulation kernel was generated for another topology, using the generic kernel.\n";
+
+	surrogate_model.reset(surrogate_features(Network(network_topology_config_file.c_str())).size());
+
+	// Worker processes are forked before the optimization starts any thread
+	if (n_eval_workers > 0) {
+		start_evaluation_workers(n_eval_workers, Network(network_topology_config_file.c_str()));
+		std::cout << "Evaluation workers: " << n_eval_workers << " processes." << std::endl;
+	}
+
+	// Optimizers of other topologies are ignored
+	MigrationLink migration_link(topology_hash.low);
+	if (networked) {
+		if (!listen_address.empty())
+			migration_link.listen(listen_address);
+		for (const std::string& peer : peer_addresses)
+			migration_link.add_peer(peer);
+		std::cout << "Migration: listening on " << (listen_address.empty()? "nothing" : listen_address) << ", " << peer_addresses.size() << " peers." << std::endl;
+	}
+
+	if (pin_threads) {
+		const EA::CpuLayout& layout = EA::CpuLayout::current();
+		std::cout << "Pinned threads: " << layout.cpus.size() << " CPUs on " << layout.N_nodes << " NUMA nodes." << std::endl;
+	}
+
+	// Its writer thread starts after the evaluation workers are forked
+	try {
+		generation_log.open("./generation_log.bin", topology_hash);
+	} catch (const std::runtime_error& e) {
+		std::cout << e.what() << ", running without generation log." << std::endl;
+	}
 
 	EA::Chronometer timer;
 	timer.tic();
 
+	// Every evaluation thread waits for one worker at a time, keep enough of them to fill the workers
+	int min_threads = 2*static_cast<int>(n_eval_workers);
+	auto configure = [min_threads, pin_threads, time_limit](GA_Type& ga) {
+		ga.problem_mode = EA::GA_MODE::SOGA;
+		ga.multi_threading = true;
+		ga.N_threads = std::max(ga.N_threads, min_threads);
+		ga.pin_threads = pin_threads;
+		ga.time_limit = time_limit;
+		ga.verbose = false;
+		ga.population = 200;
+		ga.generation_max = 1000;
+		ga.calculate_SO_total_fitness = calculate_SO_total_fitness;
+		ga.eval_solution_racing = eval_solution_racing;
+		ga.surrogate_predict = surrogate_predict;
+		ga.surrogate_candidates = 2;
+		ga.fidelity_key = evaluation_fidelity_key;
+		ga.SO_report_generation = SO_report_generation;
+		ga.best_stall_max = 10;
+		ga.elite_count = 10;
+		ga.crossover_fraction = 0.7;
+		ga.mutation_rate = 0.8;
+	};
+
+	// Started with the optimizers, whose deadlines follow within microseconds
+	start_evaluation_deadline(time_limit);
+
+	if (multi_objective) {
+		// Every node pair is an objective, the run ends with the Pareto front
+		MO_GA_Type mo_obj;
+		mo_obj.problem_mode = EA::GA_MODE::NSGA_III;
+		mo_obj.multi_threading = true;
+		mo_obj.N_threads = std::max(mo_obj.N_threads, min_threads);
+		mo_obj.pin_threads = pin_threads;
+		mo_obj.time_limit = time_limit;
+		mo_obj.verbose = false;
+		mo_obj.population = 200;
+		mo_obj.generation_max = 100; // the stall criteria only apply to single objective runs
+		mo_obj.calculate_MO_objectives = calculate_MO_objectives;
+		mo_obj.fidelity_key = evaluation_fidelity_key;
+		mo_obj.MO_report_generation = MO_report_generation;
+		mo_obj.crossover_fraction = 0.7;
+		mo_obj.mutation_rate = 0.8;
+		if (seed_given)
+			mo_obj.random_seed = seed;
+		// As many reference directions as the population can hold
+		int n_pairs = static_cast<int>(Network(network_topology_config_file.c_str()).pairs().size());
+		mo_obj.reference_vector_divisions = 1;
+		while (mo_obj.get_number_reference_vectors(n_pairs, mo_obj.reference_vector_divisions + 1) <= int(mo_obj.population))
+			++mo_obj.reference_vector_divisions;
+		std::cout << "Random seed: " << mo_obj.random_seed << ", objectives: " << n_pairs << std::endl;
+		mo_obj.solve();
+
+		generation_log.close();
+		std::cout << "The problem is optimized in "<<timer.toc()<<" seconds."<<std::endl;
+
+		const MO_Generation_Type& final_generation = mo_obj.last_generation;
+		std::cout << "\n----------------------------\nPareto front, entanglement of every pair:\n";
+		nlohmann::json pareto_front = nlohmann::json::array();
+		for (unsigned int index : final_generation.fronts[0]) {
+			const MO_GA_Type::thisChromosomeType& X = final_generation.chromosomes[index];
+			for (double pair_entanglement : X.middle_costs)
+				std::cout << pair_entanglement << "\t";
+			std::cout << "\n";
+			pareto_front.push_back(X.genes.to_json());
+		}
+		output_file.open("pareto_front_cgf.json");
+		output_file << pareto_front.dump();
+		return 0;
+	}
+
 	GA_Type ga_obj;
-	ga_obj.problem_mode = EA::GA_MODE::SOGA;
-	ga_obj.multi_threading = true;
-	ga_obj.idle_delay_us = 1; // switch between threads quickly
-	ga_obj.verbose = false;
-	ga_obj.population = 200;
-	ga_obj.generation_max = 1000;
-	ga_obj.calculate_SO_total_fitness = calculate_SO_total_fitness;
-	ga_obj.init_genes = init_genes;
-	ga_obj.eval_solution = eval_solution;
-	ga_obj.mutate = mutate;
-	ga_obj.crossover = crossover;
-	ga_obj.SO_report_generation = SO_report_generation;
-	ga_obj.best_stall_max = 10;
-	ga_obj.elite_count = 10;
-	ga_obj.crossover_fraction = 0.7;
-	ga_obj.mutation_rate = 0.8;
-	ga_obj.solve();
-
-    output_file.close();
+	configure(ga_obj);
+	if (seed_given)
+		ga_obj.random_seed = seed;
+	ga_obj.steady_state = steady_state;
+	std::cout << "Random seed: " << ga_obj.random_seed << std::endl;
+
+	std::unique_ptr<Island_Type> islands;
+	if (n_islands > 1) {
+		islands.reset(new Island_Type(n_islands, configure));
+		islands->random_seed = ga_obj.random_seed;
+		islands->N_threads = std::max(islands->N_threads, min_threads);
+		islands->migration_interval = migration_interval;
+		islands->migration_topology = migration_topology;
+		islands->report_generation = islands_report_generation;
+		islands->solve();
+	} else if (networked) {
+		// This process is one island of a model spread over several processes or hosts
+		ga_obj.solve_init();
+		EA::StopReason stop = EA::StopReason::Undefined;
+		while (stop == EA::StopReason::Undefined) {
+			stop = ga_obj.solve_next_generation();
+			if (stop == EA::StopReason::Undefined && ga_obj.generation_step % migration_interval == 0)
+				exchange_migrants(ga_obj, migration_link, 2);
+		}
+		// Peers still running get the final elites
+		exchange_migrants(ga_obj, migration_link, 2);
+	} else
+		ga_obj.solve();
+	Generation_Type& final_generation = islands? islands->island(islands->best_island()).last_generation : ga_obj.last_generation;
+
+    generation_log.close();
 
 	std::cout << "The problem is optimized in "<<timer.toc()<<" seconds."<<std::endl;
+	std::cout << "Fitness cache: " << fitness_cache.hits() << " hits, " << fitness_cache.misses() << " misses." << std::endl;
+	std::cout << "Fitness store: " << fitness_store.appended_records() << " new evaluations stored." << std::endl;
+
+    // The best individual is chosen among the elites re-scored at full fidelity, unless time is up
+    double best_full_cost;
+    Network& best_genes = time_limit > 0?
+        final_generation.chromosomes[final_generation.best_chromosome_index].genes :
+        final_generation.chromosomes[best_full_fidelity_elite(final_generation, best_full_cost)].genes;
 
     std::cout << "\n----------------------------\nAmount of entanglement of the best individual: ";
     double mean_amount_of_entanglement = 0;
-    std::random_device rseed;
-    std::mt19937 rgen(rseed()); // mersenne_twister
-    std::uniform_int_distribution<int> idist(0,500);
+    EA::Philox rgen(ga_obj.random_seed, 0);
     for (std::size_t variation = 0; variation < 15; ++variation) {
-        ga_obj.last_generation.chromosomes[ga_obj.last_generation.best_chromosome_index].genes.advance_n_time_slots(1000 +  idist(rgen));
-        mean_amount_of_entanglement += ga_obj.last_generation.chromosomes[ga_obj.last_generation.best_chromosome_index].genes.amount_entanglement();
-        ga_obj.last_generation.chromosomes[ga_obj.last_generation.best_chromosome_index].genes.reset();
+        best_genes.advance_n_time_slots(1000 + rgen() % 501);
+        mean_amount_of_entanglement += best_genes.amount_entanglement();
+        best_genes.reset();
     }
     mean_amount_of_entanglement /= 15;
-    //ga_obj.last_generation.chromosomes[ga_obj.last_generation.best_chromosome_index].genes.advance_n_time_slots(1000);
-    //ga_obj.last_generation.chromosomes[ga_obj.last_generation.best_chromosome_index].genes.print();
+    //best_genes.advance_n_time_slots(1000);
+    //best_genes.print();
 
     std::cout << mean_amount_of_entanglement << ".\n";
 
-    ga_obj.last_generation.chromosomes[ga_obj.last_generation.best_chromosome_index].genes.advance_n_time_slots(1000);
-    ga_obj.last_generation.chromosomes[ga_obj.last_generation.best_chromosome_index].genes.print();
+    best_genes.advance_n_time_slots(1000);
+    best_genes.print();
 
     std::cout << "\n----------------------------\nCompared with default soluction: ";
     Network default_network(network_topology_config_file.c_str());
 
     mean_amount_of_entanglement = 0;
     for (std::size_t variation = 0; variation < 15; ++variation) {
-        default_network.advance_n_time_slots(10000 +  idist(rgen));
+        default_network.advance_n_time_slots(10000 + rgen() % 501);
         mean_amount_of_entanglement += default_network.amount_entanglement();
         default_network.reset();
     }
@@ -81,7 +252,7 @@ int main(void) {
 
     output_file.open("best_individual_cgf.json");
 
-    output_file << ga_obj.last_generation.chromosomes[ga_obj.last_generation.best_chromosome_index].genes.to_json().dump();
+    output_file << NetworkJsonWriter().write(best_genes);
 
     return 0;
 }
\ No newline at end of file
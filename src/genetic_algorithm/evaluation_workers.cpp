@@ -0,0 +1,237 @@
+#include "genetic_algorithm/evaluation_workers.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <stdexcept>
+
+#include <semaphore.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::uint32_t shutdown_slot = 0xffffffff;
+constexpr long poll_nanoseconds = 100000000; // between checks that the worker of a slot is alive
+
+std::size_t round_up(std::size_t n, std::size_t alignment) {
+    return (n + alignment - 1)/alignment*alignment;
+}
+
+// Semaphore operations are restarted when a signal interrupts them
+void wait(sem_t* semaphore) {
+    while (sem_wait(semaphore) != 0 && errno == EINTR) {}
+}
+
+// False when the semaphore was not posted within nanoseconds
+bool timed_wait(sem_t* semaphore, long nanoseconds) {
+    timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += nanoseconds;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000;
+    deadline.tv_nsec %= 1000000000;
+    while (sem_timedwait(semaphore, &deadline) != 0)
+        if (errno != EINTR)
+            return false;
+    return true;
+}
+
+}
+
+// Queue of slot indices waiting for a worker, followed in the mapping by its entries
+struct EvaluationWorkers::Shared {
+    sem_t queued;
+    sem_t queue_lock;
+    std::uint32_t head;
+    std::uint32_t tail;
+    std::uint32_t capacity;
+};
+
+// One request in flight, followed in the mapping by the genome words
+struct EvaluationWorkers::Slot {
+    sem_t done;
+    pid_t worker; // that took the request, 0 while it is queued
+    std::uint32_t n_words;
+    std::uint32_t failed;
+    alignas(8) unsigned char request[max_request_bytes];
+    alignas(8) unsigned char response[max_response_bytes];
+};
+
+EvaluationWorkers::~EvaluationWorkers() {
+    stop();
+}
+
+void EvaluationWorkers::start(std::size_t n_workers, std::size_t max_genome_words, const Evaluator& evaluator) {
+    stop();
+    if (n_workers == 0)
+        return;
+
+    _n_slots = 2*n_workers;
+    _max_genome_words = max_genome_words;
+    std::uint32_t capacity = static_cast<std::uint32_t>(_n_slots + n_workers); // room for the shutdown requests
+    std::size_t queue_bytes = round_up(sizeof(Shared) + capacity*sizeof(std::uint32_t), 64);
+    _slot_bytes = round_up(sizeof(Slot) + max_genome_words*sizeof(std::uint32_t), 64);
+    _mapping_bytes = queue_bytes + _n_slots*_slot_bytes;
+    _mapping = mmap(nullptr, _mapping_bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (_mapping == MAP_FAILED) {
+        _mapping = nullptr;
+        throw std::runtime_error("Cannot map the evaluation worker ring");
+    }
+
+    Shared& queue = shared();
+    sem_init(&queue.queued, 1, 0);
+    sem_init(&queue.queue_lock, 1, 1);
+    queue.head = 0;
+    queue.tail = 0;
+    queue.capacity = capacity;
+    _free_slots.clear();
+    for (std::size_t i = 0; i < _n_slots; ++i) {
+        sem_init(&slot(i).done, 1, 0);
+        _free_slots.push_back(static_cast<std::uint32_t>(_n_slots - 1 - i));
+    }
+
+    // Buffered output would otherwise be written again by every worker
+    std::cout.flush();
+    std::fflush(nullptr);
+    pid_t parent = getpid();
+    for (std::size_t i = 0; i < n_workers; ++i) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            stop();
+            throw std::runtime_error("Cannot fork an evaluation worker");
+        }
+        if (pid == 0) {
+            prctl(PR_SET_PDEATHSIG, SIGTERM);
+            if (getppid() == parent)
+                worker_loop(evaluator);
+            _exit(0);
+        }
+        _workers.push_back(pid);
+        _n_workers = _workers.size();
+    }
+}
+
+void EvaluationWorkers::stop() {
+    if (_mapping == nullptr)
+        return;
+    std::lock_guard<std::mutex> lock(_workers_mtx);
+    for (std::size_t i = 0; i < _workers.size(); ++i)
+        enqueue(shutdown_slot);
+    for (pid_t pid : _workers)
+        waitpid(pid, nullptr, 0);
+    _workers.clear();
+    _n_workers = 0;
+
+    sem_destroy(&shared().queued);
+    sem_destroy(&shared().queue_lock);
+    for (std::size_t i = 0; i < _n_slots; ++i)
+        sem_destroy(&slot(i).done);
+    munmap(_mapping, _mapping_bytes);
+    _mapping = nullptr;
+    _free_slots.clear();
+}
+
+bool EvaluationWorkers::evaluate(const void* request, std::size_t request_bytes, const std::vector<std::uint32_t>& genome, void* response, std::size_t response_bytes) {
+    if (!running() || genome.size() > _max_genome_words || request_bytes > max_request_bytes || response_bytes > max_response_bytes)
+        return false;
+
+    std::uint32_t index;
+    {
+        std::unique_lock<std::mutex> lock(_free_mtx);
+        _free_cv.wait(lock, [this]() { return !_free_slots.empty(); });
+        index = _free_slots.back();
+        _free_slots.pop_back();
+    }
+
+    Slot& in_flight = slot(index);
+    std::memcpy(in_flight.request, request, request_bytes);
+    std::memcpy(reinterpret_cast<char*>(&in_flight) + sizeof(Slot), genome.data(), genome.size()*sizeof(std::uint32_t));
+    in_flight.n_words = static_cast<std::uint32_t>(genome.size());
+    in_flight.failed = 0;
+    __atomic_store_n(&in_flight.worker, 0, __ATOMIC_RELEASE);
+    enqueue(index);
+    bool evaluated = true;
+    while (!timed_wait(&in_flight.done, poll_nanoseconds)) {
+        // A dead worker never posts the slot, which no other process uses any more
+        pid_t worker = __atomic_load_n(&in_flight.worker, __ATOMIC_ACQUIRE);
+        if (worker_exited(worker)) {
+            evaluated = sem_trywait(&in_flight.done) == 0; // it may have answered just before
+            break;
+        }
+    }
+    evaluated = evaluated && !in_flight.failed;
+    if (evaluated)
+        std::memcpy(response, in_flight.response, response_bytes);
+
+    {
+        std::lock_guard<std::mutex> lock(_free_mtx);
+        _free_slots.push_back(index);
+    }
+    _free_cv.notify_one();
+    return evaluated;
+}
+
+EvaluationWorkers::Shared& EvaluationWorkers::shared() const {
+    return *static_cast<Shared*>(_mapping);
+}
+
+EvaluationWorkers::Slot& EvaluationWorkers::slot(std::size_t index) const {
+    std::size_t queue_bytes = round_up(sizeof(Shared) + shared().capacity*sizeof(std::uint32_t), 64);
+    return *reinterpret_cast<Slot*>(static_cast<char*>(_mapping) + queue_bytes + index*_slot_bytes);
+}
+
+// Reaps the workers that exited. True when worker (0 for a request still queued) is not
+// running any more, or when no worker is left to take a queued request.
+bool EvaluationWorkers::worker_exited(pid_t worker) {
+    std::lock_guard<std::mutex> lock(_workers_mtx);
+    for (std::size_t i = 0; i < _workers.size();) {
+        if (waitpid(_workers[i], nullptr, WNOHANG) != _workers[i]) {
+            ++i;
+            continue;
+        }
+        _workers.erase(_workers.begin() + i);
+        _n_workers = _workers.size();
+        std::cout << "An evaluation worker exited, " << _workers.size() << " left." << std::endl;
+    }
+    return _workers.empty() || (worker != 0 && std::find(_workers.begin(), _workers.end(), worker) == _workers.end());
+}
+
+void EvaluationWorkers::enqueue(std::uint32_t index) {
+    Shared& queue = shared();
+    std::uint32_t* entries = reinterpret_cast<std::uint32_t*>(&queue + 1);
+    wait(&queue.queue_lock);
+    entries[queue.tail] = index;
+    queue.tail = (queue.tail + 1) % queue.capacity;
+    sem_post(&queue.queue_lock);
+    sem_post(&queue.queued);
+}
+
+void EvaluationWorkers::worker_loop(const Evaluator& evaluator) {
+    Shared& queue = shared();
+    const std::uint32_t* entries = reinterpret_cast<const std::uint32_t*>(&queue + 1);
+    while (true) {
+        wait(&queue.queued);
+        wait(&queue.queue_lock);
+        std::uint32_t index = entries[queue.head];
+        queue.head = (queue.head + 1) % queue.capacity;
+        if (index != shutdown_slot)
+            __atomic_store_n(&slot(index).worker, getpid(), __ATOMIC_RELEASE);
+        sem_post(&queue.queue_lock);
+        if (index == shutdown_slot)
+            return;
+
+        Slot& in_flight = slot(index);
+        try {
+            evaluator(in_flight.request, reinterpret_cast<const std::uint32_t*>(reinterpret_cast<const char*>(&in_flight) + sizeof(Slot)), in_flight.n_words, in_flight.response);
+        } catch (...) {
+            in_flight.failed = 1; // the caller evaluates it itself
+        }
+        sem_post(&in_flight.done);
+    }
+}
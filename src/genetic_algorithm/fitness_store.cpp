@@ -0,0 +1,170 @@
+#include "genetic_algorithm/fitness_store.hpp"
+
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+struct FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t record_size;
+    char reserved[48];
+};
+static_assert(sizeof(FileHeader) == 64, "FitnessStore header must be 64 bytes");
+
+constexpr char store_magic[8] = {'C', 'N', 'A', 'F', 'I', 'T', 'D', 'B'};
+constexpr std::uint32_t store_version = 1;
+
+}
+
+FitnessStore::~FitnessStore() {
+    close();
+}
+
+void FitnessStore::open(const std::string& path, const Hash128& topology_hash) {
+    close();
+
+    _fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (_fd < 0)
+        throw std::runtime_error("Cannot open fitness store " + path);
+    _topology_hash = topology_hash;
+
+    // Initialise the header and drop a torn trailing record under an exclusive lock,
+    // so that appends from every process stay aligned to whole records.
+    flock(_fd, LOCK_EX);
+    struct stat st;
+    fstat(_fd, &st);
+    std::size_t size = static_cast<std::size_t>(st.st_size);
+    if (size < sizeof(FileHeader)) {
+        FileHeader header{};
+        std::memcpy(header.magic, store_magic, sizeof(store_magic));
+        header.version = store_version;
+        header.record_size = sizeof(Record);
+        if (ftruncate(_fd, 0) != 0 || write(_fd, &header, sizeof(header)) != static_cast<ssize_t>(sizeof(header))) {
+            flock(_fd, LOCK_UN);
+            close();
+            throw std::runtime_error("Cannot initialise fitness store " + path);
+        }
+    } else {
+        FileHeader header;
+        if (pread(_fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))
+         || std::memcmp(header.magic, store_magic, sizeof(store_magic)) != 0
+         || header.version != store_version
+         || header.record_size != sizeof(Record)) {
+            flock(_fd, LOCK_UN);
+            close();
+            throw std::runtime_error("Incompatible fitness store " + path);
+        }
+        std::size_t torn = (size - sizeof(FileHeader)) % sizeof(Record);
+        if (torn != 0 && ftruncate(_fd, static_cast<off_t>(size - torn)) != 0) {
+            flock(_fd, LOCK_UN);
+            close();
+            throw std::runtime_error("Cannot repair fitness store " + path);
+        }
+    }
+    flock(_fd, LOCK_UN);
+
+    _scanned_bytes = sizeof(FileHeader);
+    std::unique_lock<std::shared_mutex> lock(_mtx);
+    load_new_records();
+}
+
+void FitnessStore::close() {
+    if (_fd >= 0)
+        ::close(_fd);
+    _fd = -1;
+    _index.clear();
+    _scanned_bytes = 0;
+    _loaded_records = 0;
+    _appended_records = 0;
+    _unscanned_own_bytes = 0;
+}
+
+bool FitnessStore::lookup(const Hash128& genome_hash, std::uint64_t evaluation_parameters, double& cost) {
+    if (_fd < 0)
+        return false;
+    std::shared_lock<std::shared_mutex> lock(_mtx);
+    auto it = _index.find(index_key(genome_hash, evaluation_parameters));
+    if (it == _index.end())
+        return false;
+    cost = it->second;
+    return true;
+}
+
+void FitnessStore::refresh() {
+    if (_fd < 0)
+        return;
+    std::unique_lock<std::shared_mutex> lock(_mtx);
+    load_new_records();
+}
+
+void FitnessStore::append(const Hash128& genome_hash, std::uint64_t evaluation_parameters, double cost) {
+    if (_fd < 0)
+        return;
+    Record record{};
+    record.topology_hash = _topology_hash;
+    record.genome_hash = genome_hash;
+    record.evaluation_parameters = evaluation_parameters;
+    record.cost = cost;
+    record.checksum = checksum(record);
+
+    std::unique_lock<std::shared_mutex> lock(_mtx);
+    // O_APPEND makes a single record write atomic with respect to other writers
+    if (write(_fd, &record, sizeof(record)) == static_cast<ssize_t>(sizeof(record))) {
+        _index[index_key(genome_hash, evaluation_parameters)] = cost;
+        ++_appended_records;
+        _unscanned_own_bytes += sizeof(record);
+    }
+}
+
+Hash128 FitnessStore::index_key(const Hash128& genome_hash, std::uint64_t evaluation_parameters) {
+    return Hasher128().add(genome_hash.low).add(genome_hash.high).add(evaluation_parameters).finish();
+}
+
+std::uint64_t FitnessStore::checksum(const Record& record) {
+    std::uint64_t cost_bits;
+    std::memcpy(&cost_bits, &record.cost, sizeof(cost_bits));
+    return Hasher128(store_version)
+        .add(record.topology_hash.low).add(record.topology_hash.high)
+        .add(record.genome_hash.low).add(record.genome_hash.high)
+        .add(record.evaluation_parameters)
+        .add(cost_bits)
+        .finish().low;
+}
+
+void FitnessStore::load_new_records() {
+    struct stat st;
+    if (fstat(_fd, &st) != 0)
+        return;
+    std::size_t size = static_cast<std::size_t>(st.st_size);
+    // Nothing new unless other processes appended beyond our own records
+    if (size <= _scanned_bytes + _unscanned_own_bytes)
+        return;
+    std::size_t end = _scanned_bytes + (size - _scanned_bytes)/sizeof(Record)*sizeof(Record);
+
+    void* mapping = mmap(nullptr, end, PROT_READ, MAP_SHARED, _fd, 0);
+    if (mapping == MAP_FAILED)
+        return;
+
+    const Record* records = reinterpret_cast<const Record*>(static_cast<const char*>(mapping) + _scanned_bytes);
+    std::size_t n_records = (end - _scanned_bytes)/sizeof(Record);
+    for (std::size_t i = 0; i < n_records; ++i) {
+        const Record& record = records[i];
+        if (record.topology_hash != _topology_hash || record.checksum != checksum(record))
+            continue;
+        _index[index_key(record.genome_hash, record.evaluation_parameters)] = record.cost;
+        ++_loaded_records;
+    }
+
+    munmap(mapping, end);
+    _scanned_bytes = end;
+    _unscanned_own_bytes = 0;
+}
@@ -0,0 +1,249 @@
+#include "genetic_algorithm/generation_log.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+struct FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t reserved;
+    Hash128 topology_hash;
+};
+static_assert(sizeof(FileHeader) == 32, "GenerationLog header must be 32 bytes");
+
+// Followed by the columns generation, best, average, exe_time, delta_prefix, delta_suffix,
+// delta_length (n_rows entries each), the delta words and the checksum of all of it.
+struct BlockHeader {
+    std::uint32_t magic;
+    std::uint32_t n_rows;
+    std::uint32_t n_delta_words;
+    std::uint32_t reserved;
+};
+
+constexpr char log_magic[8] = {'C', 'N', 'A', 'G', 'E', 'N', 'L', 'G'};
+constexpr std::uint32_t log_version = 1;
+constexpr std::uint32_t block_magic = 0x4b4c4247; // "GBLK"
+
+std::uint64_t checksum(const std::string& bytes) {
+    Hasher128 hasher(log_version);
+    for (std::size_t position = 0; position < bytes.size(); position += sizeof(std::uint64_t)) {
+        std::uint64_t word = 0;
+        std::memcpy(&word, bytes.data() + position, std::min(sizeof(word), bytes.size() - position));
+        hasher.add(word);
+    }
+    return hasher.add(bytes.size()).finish().low;
+}
+
+template<typename T>
+void put_column(std::string& bytes, const std::vector<T>& column) {
+    bytes.append(reinterpret_cast<const char*>(column.data()), column.size()*sizeof(T));
+}
+
+// Reads n values at position, false past the end
+template<typename T>
+bool get_column(const std::string& bytes, std::size_t& position, std::size_t n, std::vector<T>& column) {
+    if ((bytes.size() - position)/sizeof(T) < n)
+        return false;
+    column.resize(n);
+    std::memcpy(column.data(), bytes.data() + position, n*sizeof(T));
+    position += n*sizeof(T);
+    return true;
+}
+
+bool write_all(int fd, const std::string& bytes) {
+    std::size_t written = 0;
+    while (written < bytes.size()) {
+        ssize_t n = write(fd, bytes.data() + written, bytes.size() - written);
+        if (n <= 0)
+            return false;
+        written += static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+// Appends rows as one block, their genomes as deltas from previous, which ends as the last genome
+void write_block(int fd, const std::vector<GenerationLog::Snapshot>& rows, std::vector<std::uint32_t>& previous) {
+    std::size_t n = rows.size();
+    std::vector<std::int32_t> generation(n);
+    std::vector<double> best(n), average(n), exe_time(n);
+    std::vector<std::uint32_t> delta_prefix(n), delta_suffix(n), delta_length(n), delta_words;
+    for (std::size_t row = 0; row < n; ++row) {
+        const GenerationLog::Snapshot& snapshot = rows[row];
+        generation[row] = snapshot.generation;
+        best[row] = snapshot.best;
+        average[row] = snapshot.average;
+        exe_time[row] = snapshot.exe_time;
+
+        // Words shared with the previous genome at the start and at the end are not stored
+        const std::vector<std::uint32_t>& genome = snapshot.genome;
+        std::size_t common = std::min(genome.size(), previous.size());
+        std::size_t prefix = std::mismatch(genome.begin(), genome.begin() + common, previous.begin()).first - genome.begin();
+        std::size_t suffix = std::mismatch(genome.rbegin(), genome.rbegin() + (common - prefix), previous.rbegin()).first - genome.rbegin();
+        delta_prefix[row] = static_cast<std::uint32_t>(prefix);
+        delta_suffix[row] = static_cast<std::uint32_t>(suffix);
+        delta_length[row] = static_cast<std::uint32_t>(genome.size() - prefix - suffix);
+        delta_words.insert(delta_words.end(), genome.begin() + prefix, genome.end() - suffix);
+        previous = genome;
+    }
+
+    BlockHeader header{block_magic, static_cast<std::uint32_t>(n), static_cast<std::uint32_t>(delta_words.size()), 0};
+    std::string bytes(reinterpret_cast<const char*>(&header), sizeof(header));
+    put_column(bytes, generation);
+    put_column(bytes, best);
+    put_column(bytes, average);
+    put_column(bytes, exe_time);
+    put_column(bytes, delta_prefix);
+    put_column(bytes, delta_suffix);
+    put_column(bytes, delta_length);
+    put_column(bytes, delta_words);
+    std::uint64_t sum = checksum(bytes);
+    bytes.append(reinterpret_cast<const char*>(&sum), sizeof(sum));
+    write_all(fd, bytes); // a failed write leaves a torn block, where reading stops
+}
+
+}
+
+GenerationLog::~GenerationLog() {
+    close();
+}
+
+void GenerationLog::open(const std::string& path, const Hash128& topology_hash) {
+    close();
+
+    _fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+    if (_fd < 0)
+        throw std::runtime_error("Cannot open generation log " + path);
+    FileHeader header{};
+    std::memcpy(header.magic, log_magic, sizeof(log_magic));
+    header.version = log_version;
+    header.topology_hash = topology_hash;
+    if (!write_all(_fd, std::string(reinterpret_cast<const char*>(&header), sizeof(header)))) {
+        ::close(_fd);
+        _fd = -1;
+        throw std::runtime_error("Cannot write generation log " + path);
+    }
+
+    _stopping = false;
+    _writer = std::thread(&GenerationLog::write_loop, this);
+}
+
+void GenerationLog::close() {
+    if (_fd < 0)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _stopping = true;
+    }
+    _queued_cv.notify_one();
+    _writer.join();
+    ::close(_fd);
+    _fd = -1;
+}
+
+void GenerationLog::report(Snapshot&& snapshot) {
+    if (!is_open())
+        return;
+    {
+        std::unique_lock<std::mutex> lock(_mtx);
+        _space_cv.wait(lock, [this]() { return _queue.size() < queue_capacity; });
+        _queue.push_back(std::move(snapshot));
+    }
+    _queued_cv.notify_one();
+}
+
+void GenerationLog::write_loop() {
+    std::vector<Snapshot> pending;
+    std::vector<std::uint32_t> previous;
+    std::unique_lock<std::mutex> lock(_mtx);
+    while (true) {
+        bool queued = _queued_cv.wait_for(lock, std::chrono::milliseconds(flush_interval_ms),
+            [this]() { return _stopping || !_queue.empty(); });
+        while (!_queue.empty() && pending.size() < block_rows) {
+            pending.push_back(std::move(_queue.front()));
+            _queue.pop_front();
+        }
+        _space_cv.notify_all();
+        bool stopping = _stopping && _queue.empty();
+
+        if (pending.size() >= block_rows || (!queued && !pending.empty()) || stopping) {
+            lock.unlock();
+            if (!pending.empty())
+                write_block(_fd, pending, previous);
+            pending.clear();
+            lock.lock();
+        }
+        if (stopping)
+            return;
+    }
+}
+
+std::vector<GenerationLog::Snapshot> GenerationLog::read(const std::string& path, Hash128& topology_hash) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("Cannot open generation log " + path);
+    std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    FileHeader header;
+    if (bytes.size() < sizeof(header))
+        throw std::runtime_error(path + " is not a generation log");
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    if (std::memcmp(header.magic, log_magic, sizeof(log_magic)) != 0 || header.version != log_version)
+        throw std::runtime_error(path + " is not a generation log of version " + std::to_string(log_version));
+    topology_hash = header.topology_hash;
+
+    std::vector<Snapshot> snapshots;
+    std::vector<std::uint32_t> previous;
+    std::size_t position = sizeof(header);
+    while (bytes.size() - position >= sizeof(BlockHeader)) {
+        std::size_t block_begin = position;
+        BlockHeader block;
+        std::memcpy(&block, bytes.data() + position, sizeof(block));
+        position += sizeof(block);
+        if (block.magic != block_magic)
+            break;
+
+        std::size_t n = block.n_rows;
+        std::vector<std::int32_t> generation;
+        std::vector<double> best, average, exe_time;
+        std::vector<std::uint32_t> delta_prefix, delta_suffix, delta_length, delta_words;
+        std::uint64_t sum;
+        if (!get_column(bytes, position, n, generation) || !get_column(bytes, position, n, best)
+         || !get_column(bytes, position, n, average) || !get_column(bytes, position, n, exe_time)
+         || !get_column(bytes, position, n, delta_prefix) || !get_column(bytes, position, n, delta_suffix)
+         || !get_column(bytes, position, n, delta_length) || !get_column(bytes, position, block.n_delta_words, delta_words)
+         || bytes.size() - position < sizeof(sum))
+            break;
+        std::memcpy(&sum, bytes.data() + position, sizeof(sum));
+        if (sum != checksum(bytes.substr(block_begin, position - block_begin)))
+            break;
+        position += sizeof(sum);
+
+        std::size_t delta_position = 0;
+        for (std::size_t row = 0; row < n; ++row) {
+            if (std::size_t(delta_prefix[row]) + delta_suffix[row] > previous.size()
+             || delta_length[row] > delta_words.size() - delta_position)
+                throw std::runtime_error("Inconsistent genome delta in " + path);
+            Snapshot snapshot;
+            snapshot.generation = generation[row];
+            snapshot.best = best[row];
+            snapshot.average = average[row];
+            snapshot.exe_time = exe_time[row];
+            snapshot.genome.assign(previous.begin(), previous.begin() + delta_prefix[row]);
+            snapshot.genome.insert(snapshot.genome.end(), delta_words.begin() + delta_position, delta_words.begin() + delta_position + delta_length[row]);
+            snapshot.genome.insert(snapshot.genome.end(), previous.end() - delta_suffix[row], previous.end());
+            delta_position += delta_length[row];
+            previous = snapshot.genome;
+            snapshots.push_back(std::move(snapshot));
+        }
+    }
+    return snapshots;
+}
@@ -0,0 +1,279 @@
+#include "genetic_algorithm/migration_link.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::uint32_t message_magic = 0x4d414e43; // "CNAM"
+constexpr std::uint32_t message_version = 1;
+constexpr std::uint64_t max_message_bytes = 64 << 20;
+constexpr int connect_timeout_ms = 200;
+constexpr int transfer_timeout_s = 2;
+
+const std::string unix_prefix = "unix:";
+
+struct Endpoint {
+    sockaddr_storage address;
+    socklen_t length;
+};
+
+Endpoint resolve(const std::string& address) {
+    Endpoint endpoint{};
+    if (address.compare(0, unix_prefix.size(), unix_prefix) == 0) {
+        std::string path = address.substr(unix_prefix.size());
+        sockaddr_un* un = reinterpret_cast<sockaddr_un*>(&endpoint.address);
+        if (path.empty() || path.size() >= sizeof(un->sun_path))
+            throw std::runtime_error("Invalid Unix socket path " + address);
+        un->sun_family = AF_UNIX;
+        std::memcpy(un->sun_path, path.c_str(), path.size() + 1);
+        endpoint.length = sizeof(sockaddr_un);
+        return endpoint;
+    }
+
+    std::size_t colon = address.rfind(':');
+    if (colon == std::string::npos)
+        throw std::runtime_error("Address " + address + " is neither host:port nor unix:/path");
+    std::string host = address.substr(0, colon), port = address.substr(colon + 1);
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = host.empty()? AI_PASSIVE : 0;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.empty()? nullptr : host.c_str(), port.c_str(), &hints, &result) != 0 || result == nullptr)
+        throw std::runtime_error("Cannot resolve " + address);
+    std::memcpy(&endpoint.address, result->ai_addr, result->ai_addrlen);
+    endpoint.length = result->ai_addrlen;
+    freeaddrinfo(result);
+    return endpoint;
+}
+
+bool write_all(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t written = send(fd, data, size, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+bool read_all(int fd, char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t n_read = recv(fd, data, size, 0);
+        if (n_read < 0 && errno == EINTR)
+            continue;
+        if (n_read <= 0)
+            return false;
+        data += n_read;
+        size -= static_cast<std::size_t>(n_read);
+    }
+    return true;
+}
+
+void set_timeouts(int fd) {
+    timeval timeout{transfer_timeout_s, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+template<typename T>
+void put(std::string& bytes, const T& value) {
+    bytes.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void put(std::string& bytes, const std::string& value) {
+    put(bytes, static_cast<std::uint32_t>(value.size()));
+    bytes.append(value);
+}
+
+// Reads from a received message, failing once past its end
+class Reader {
+public:
+    explicit Reader(const std::string& bytes): _bytes(bytes) {}
+
+    template<typename T>
+    bool get(T& value) {
+        if (_bytes.size() - _position < sizeof(value))
+            return false;
+        std::memcpy(&value, _bytes.data() + _position, sizeof(value));
+        _position += sizeof(value);
+        return true;
+    }
+
+    std::size_t remaining() const { return _bytes.size() - _position; }
+
+    bool get(std::string& value) {
+        std::uint32_t size;
+        if (!get(size) || _bytes.size() - _position < size)
+            return false;
+        value.assign(_bytes, _position, size);
+        _position += size;
+        return true;
+    }
+
+private:
+    const std::string& _bytes;
+    std::size_t _position = 0;
+};
+
+std::string serialize(const MigrationLink::Message& message, std::uint64_t tag) {
+    std::string bytes;
+    put(bytes, std::uint64_t(0)); // size, filled in below
+    put(bytes, message_magic);
+    put(bytes, message_version);
+    put(bytes, message.sender);
+    put(bytes, tag);
+    put(bytes, message.best_cost);
+    put(bytes, static_cast<std::uint32_t>(message.migrants.size()));
+    for (const std::pair<double, std::string>& migrant : message.migrants) {
+        put(bytes, migrant.first);
+        put(bytes, migrant.second);
+    }
+    std::uint64_t size = bytes.size() - sizeof(std::uint64_t);
+    std::memcpy(&bytes[0], &size, sizeof(size));
+    return bytes;
+}
+
+bool deserialize(const std::string& bytes, MigrationLink::Message& message) {
+    Reader reader(bytes);
+    std::uint32_t magic, version, n_migrants;
+    if (!reader.get(magic) || magic != message_magic || !reader.get(version) || version != message_version)
+        return false;
+    if (!reader.get(message.sender) || !reader.get(message.tag) || !reader.get(message.best_cost) || !reader.get(n_migrants))
+        return false;
+    // Every migrant takes at least its cost and the size of its genome
+    if (n_migrants > reader.remaining()/(sizeof(double) + sizeof(std::uint32_t)))
+        return false;
+    for (std::uint32_t i = 0; i < n_migrants; ++i) {
+        std::pair<double, std::string> migrant;
+        if (!reader.get(migrant.first) || !reader.get(migrant.second))
+            return false;
+        message.migrants.push_back(std::move(migrant));
+    }
+    return true;
+}
+
+// Connects within connect_timeout_ms, -1 when the peer is not there (yet)
+int connect_to(const std::string& address) {
+    Endpoint endpoint = resolve(address);
+    int fd = socket(endpoint.address.ss_family, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&endpoint.address), endpoint.length) != 0) {
+        pollfd request{fd, POLLOUT, 0};
+        int error = 0;
+        socklen_t error_length = sizeof(error);
+        if (errno != EINPROGRESS || poll(&request, 1, connect_timeout_ms) != 1
+         || getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_length) != 0 || error != 0) {
+            ::close(fd);
+            return -1;
+        }
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    set_timeouts(fd);
+    return fd;
+}
+
+}
+
+MigrationLink::~MigrationLink() {
+    close();
+}
+
+void MigrationLink::listen(const std::string& address) {
+    close();
+    Endpoint endpoint = resolve(address);
+    _listen_fd = socket(endpoint.address.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (_listen_fd < 0)
+        throw std::runtime_error("Cannot create a socket for " + address);
+    if (endpoint.address.ss_family == AF_UNIX)
+        unlink(reinterpret_cast<const sockaddr_un*>(&endpoint.address)->sun_path); // left by a previous run
+    else {
+        int reuse = 1;
+        setsockopt(_listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    }
+    if (bind(_listen_fd, reinterpret_cast<const sockaddr*>(&endpoint.address), endpoint.length) != 0
+     || ::listen(_listen_fd, 16) != 0) {
+        ::close(_listen_fd);
+        _listen_fd = -1;
+        throw std::runtime_error("Cannot listen on " + address);
+    }
+    _address = address;
+    _stopping = false;
+    _receiver = std::thread(&MigrationLink::receive_loop, this);
+}
+
+void MigrationLink::close() {
+    if (_listen_fd < 0)
+        return;
+    _stopping = true;
+    _receiver.join();
+    ::close(_listen_fd);
+    _listen_fd = -1;
+    if (_address.compare(0, unix_prefix.size(), unix_prefix) == 0)
+        unlink(_address.c_str() + unix_prefix.size());
+}
+
+void MigrationLink::add_peer(const std::string& address) {
+    resolve(address); // rejects malformed addresses now rather than at every broadcast
+    _peers.push_back(address);
+}
+
+std::size_t MigrationLink::broadcast(const Message& message) {
+    std::string bytes = serialize(message, _tag);
+    std::size_t delivered = 0;
+    for (const std::string& peer : _peers) {
+        int fd = connect_to(peer);
+        if (fd < 0)
+            continue;
+        if (write_all(fd, bytes.data(), bytes.size()))
+            ++delivered;
+        ::close(fd);
+    }
+    return delivered;
+}
+
+std::vector<MigrationLink::Message> MigrationLink::receive() {
+    std::lock_guard<std::mutex> lock(_inbox_mtx);
+    std::vector<Message> received;
+    received.swap(_inbox);
+    return received;
+}
+
+void MigrationLink::receive_loop() {
+    while (!_stopping) {
+        pollfd request{_listen_fd, POLLIN, 0};
+        if (poll(&request, 1, 100) != 1)
+            continue;
+        int fd = accept4(_listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0)
+            continue;
+        set_timeouts(fd);
+        // A message that cannot be read drops its connection, not the process
+        try {
+            std::uint64_t size;
+            std::string bytes;
+            Message message;
+            if (read_all(fd, reinterpret_cast<char*>(&size), sizeof(size)) && size <= max_message_bytes) {
+                bytes.resize(size);
+                if (read_all(fd, &bytes[0], size) && deserialize(bytes, message) && message.tag == _tag) {
+                    std::lock_guard<std::mutex> lock(_inbox_mtx);
+                    _inbox.push_back(std::move(message));
+                }
+            }
+        } catch (const std::exception&) {}
+        ::close(fd);
+    }
+}
@@ -0,0 +1,114 @@
+#include "genetic_algorithm/surrogate_model.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+RidgeSurrogate::RidgeSurrogate(std::size_t n_features, double ridge, double forgetting):
+    _n_features(0),
+    _ridge(ridge),
+    _forgetting(forgetting) {
+    reset(n_features);
+}
+
+void RidgeSurrogate::reset(std::size_t n_features) {
+    std::unique_lock<std::shared_mutex> lock(_mtx);
+    _n_features = n_features;
+    _xtx.assign(n_features*n_features, 0.0);
+    _xty.assign(n_features, 0.0);
+    _weights.assign(n_features, 0.0);
+    _effective_observations = 0;
+    _n_observations = 0;
+    _fitted = false;
+}
+
+void RidgeSurrogate::observe(std::uint64_t key, std::vector<double> features, double target) {
+    if (features.size() != _n_features || !std::isfinite(target))
+        return;
+    std::lock_guard<std::mutex> lock(_pending_mtx);
+    _pending.push_back(Observation{key, std::move(features), target});
+}
+
+void RidgeSurrogate::fit() {
+    std::vector<Observation> pending;
+    {
+        std::lock_guard<std::mutex> lock(_pending_mtx);
+        pending.swap(_pending);
+    }
+    if (pending.empty())
+        return;
+    std::sort(pending.begin(), pending.end(), [](const Observation& a, const Observation& b) {
+        return a.key < b.key || (a.key == b.key && a.target < b.target);
+    });
+    // The same genome evaluated concurrently by two threads is observed twice
+    pending.erase(std::unique(pending.begin(), pending.end(), [](const Observation& a, const Observation& b) {
+        return a.key == b.key && a.target == b.target;
+    }), pending.end());
+
+    std::unique_lock<std::shared_mutex> lock(_mtx);
+    const std::size_t n = _n_features;
+
+    // Older batches fade out as the population moves
+    for (double& v : _xtx) v *= _forgetting;
+    for (double& v : _xty) v *= _forgetting;
+    _effective_observations *= _forgetting;
+
+    for (const Observation& observation : pending) {
+        const std::vector<double>& x = observation.features;
+        for (std::size_t i = 0; i < n; ++i) {
+            _xty[i] += x[i]*observation.target;
+            for (std::size_t j = 0; j < n; ++j)
+                _xtx[i*n + j] += x[i]*x[j];
+        }
+    }
+    _effective_observations += pending.size();
+    _n_observations += pending.size();
+
+    // Cholesky factorisation of X^T X + ridge*I, then two triangular solves
+    std::vector<double> l(n*n, 0.0);
+    for (std::size_t i = 0; i < n; ++i) {
+        for (std::size_t j = 0; j <= i; ++j) {
+            double sum = _xtx[i*n + j] + (i == j? _ridge*std::max(_effective_observations, 1.0) : 0.0);
+            for (std::size_t k = 0; k < j; ++k)
+                sum -= l[i*n + k]*l[j*n + k];
+            if (i == j) {
+                if (sum <= 0.0) {
+                    _fitted = false;
+                    return;
+                }
+                l[i*n + i] = std::sqrt(sum);
+            } else
+                l[i*n + j] = sum/l[j*n + j];
+        }
+    }
+    std::vector<double> y(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        double sum = _xty[i];
+        for (std::size_t k = 0; k < i; ++k)
+            sum -= l[i*n + k]*y[k];
+        y[i] = sum/l[i*n + i];
+    }
+    for (std::size_t ii = 0; ii < n; ++ii) {
+        std::size_t i = n - 1 - ii;
+        double sum = y[i];
+        for (std::size_t k = i + 1; k < n; ++k)
+            sum -= l[k*n + i]*_weights[k];
+        _weights[i] = sum/l[i*n + i];
+    }
+    _fitted = true;
+}
+
+bool RidgeSurrogate::ready() const {
+    std::shared_lock<std::shared_mutex> lock(_mtx);
+    return _fitted && _effective_observations >= 2.0*_n_features;
+}
+
+double RidgeSurrogate::predict(const std::vector<double>& features) const {
+    std::shared_lock<std::shared_mutex> lock(_mtx);
+    if (!_fitted || _effective_observations < 2.0*_n_features || features.size() != _n_features)
+        return std::numeric_limits<double>::quiet_NaN();
+    double prediction = 0.0;
+    for (std::size_t i = 0; i < _n_features; ++i)
+        prediction += _weights[i]*features[i];
+    return prediction;
+}
@@ -0,0 +1,41 @@
+#include "network_model/network.hpp"
+#include "network_model/network_binary.hpp"
+#include "network_model/network_json_writer.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+std::string network_topology_config_file;
+
+// Converts a topology or genome, JSON or binary, to a binary network file, or to JSON with --json.
+int main(int argc, char** argv) {
+    bool json_output = argc == 4 && std::string(argv[3]) == "--json";
+    if (argc != 3 && !json_output) {
+        std::cerr << "Usage: " << argv[0] << " <network.json|network.bin> <output> [--json]\n";
+        return 1;
+    }
+    network_topology_config_file = argv[1];
+
+    try {
+        Network network(argv[1]);
+        if (!json_output) {
+            NetworkBinaryFile::write(argv[2], network);
+            return 0;
+        }
+        std::ofstream output(argv[2]);
+        output << NetworkJsonWriter().write(network);
+        if (!output) {
+            std::cerr << "Could not write " << argv[2] << "\n";
+            return 1;
+        }
+    } catch (const char* e) {
+        std::cerr << argv[1] << ": " << e << "\n";
+        return 1;
+    } catch (const std::exception& e) {
+        std::cerr << argv[1] << ": " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
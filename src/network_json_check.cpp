@@ -0,0 +1,57 @@
+#include "network_model/network.hpp"
+#include "network_model/network_json_writer.hpp"
+
+#include <iostream>
+#include <random>
+#include <string>
+
+std::string network_topology_config_file;
+
+// Checks that NetworkJsonWriter writes the text of Network::to_json().dump(), for every network
+// given and for random genomes of its topology drawn from a fixed seed.
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <network.json|network.bin>...\n";
+        return 1;
+    }
+    const std::size_t n_genomes = 200;
+
+    int mismatches = 0;
+    for (int arg = 1; arg < argc; ++arg) {
+        network_topology_config_file = argv[arg];
+        try {
+            Network network(argv[arg]);
+            NetworkJsonWriter writer;
+            std::mt19937_64 rgen(arg);
+            std::uniform_real_distribution<double> uniform(0.0, 1.0);
+            auto rnd01 = [&rgen, &uniform]() { return uniform(rgen); };
+
+            int file_mismatches = 0;
+            for (std::size_t genome = 0; genome <= n_genomes; ++genome) {
+                if (genome > 0) {
+                    // Half of the genomes random, the other half mutated from the previous one
+                    if (genome % 2 == 1)
+                        network.init_network_random_instruction_tables(rnd01);
+                    else
+                        network.mutate(rnd01);
+                    network.canonicalize();
+                }
+                if (writer.write(network) != network.to_json().dump()) {
+                    if (file_mismatches == 0)
+                        std::cerr << argv[arg] << ": genome " << genome << " is not written as to_json().dump()\n";
+                    ++file_mismatches;
+                }
+            }
+            std::cout << argv[arg] << ": " << n_genomes + 1 - file_mismatches << "/" << n_genomes + 1 << " genomes match\n";
+            mismatches += file_mismatches;
+        } catch (const char* e) {
+            std::cerr << argv[arg] << ": " << e << "\n";
+            return 1;
+        } catch (const std::exception& e) {
+            std::cerr << argv[arg] << ": " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    return mismatches == 0? 0 : 1;
+}
@@ -7,6 +7,11 @@ std::string SwapPair::to_string() const {
     return std::to_string(e1.lock()->n_interface())+"-"+std::to_string(e2.lock()->n_interface());
 }
 
+std::uint64_t SwapPair::canonical_key() const {
+    std::uint64_t n1 = e1.lock()->n_interface(), n2 = e2.lock()->n_interface();
+    return n1 < n2? (n1 << 32) | n2 : (n2 << 32) | n1;
+}
+
 void Swap::execute() {
     std::shared_ptr<EntanglementInterface>
         tmp_e1 = _swap_pair.e1.lock(),
@@ -10,6 +10,16 @@
 
 #include <iostream>
 
+static std::vector<SwapPair> rebound_swaps(Node* context, const TimeSlot& other) {
+    std::vector<SwapPair> swap_instructions;
+    swap_instructions.reserve(other.swap_instructions().size());
+    for (const Swap& swap : other.swap_instructions()) {
+        SwapPair pair = swap.swap_pair();
+        swap_instructions.push_back(SwapPair{(*context)[pair.e1.lock()->n_interface()], (*context)[pair.e2.lock()->n_interface()]});
+    }
+    return swap_instructions;
+}
+
 TimeSlot::TimeSlot(Node* context, const std::vector<SwapPair>& swap_instructions):
     _context(context) {
     
@@ -44,6 +54,9 @@ TimeSlot::TimeSlot(Node* context, const std::vector<SwapPair>& swap_instructions
     }
 }
 
+TimeSlot::TimeSlot(Node* context, const TimeSlot& other):
+    TimeSlot(context, rebound_swaps(context, other)) {}
+
 void TimeSlot::execute_swaps() {
     for (Swap& instruction : _swap_instructions)
         instruction.execute();
@@ -54,61 +67,27 @@ void TimeSlot::execute_stores(std::uint32_t time_slot_duration_nanoseconds) {
         instruction.execute(time_slot_duration_nanoseconds);
 }
 
-void TimeSlot::mutate(const std::function<double(void)>& rnd01) {
-    if (_context->n_interfaces() < 2) return;
-
-    double action = rnd01();
-    if (action < 0.333) {
-        //Change one swap for two stores
-        if (_swap_instructions.size() < 1) return;
-
-        Swap& swap_to_change = _swap_instructions[static_cast<std::size_t>(rnd01()*_swap_instructions.size())];
-        _swap_instructions.erase(
-            std::find(
-                _swap_instructions.begin(), _swap_instructions.end(), swap_to_change
-            )
-        );
-        _store_instructions.push_back(Store(swap_to_change.swap_pair().e1));
-        _store_instructions.push_back(Store(swap_to_change.swap_pair().e2));
-    } else if (action < 0.666) {
-        //Change two stores for one swap
-        if (_store_instructions.size() < 2) return;
-        Store store1 = _store_instructions[static_cast<std::size_t>(rnd01()*_store_instructions.size())];
-        _store_instructions.erase(
-            std::find(
-                _store_instructions.begin(), _store_instructions.end(), store1
-            )
-        );
-        Store store2 = _store_instructions[static_cast<std::size_t>(rnd01()*_store_instructions.size())];
-        _store_instructions.erase(
-            std::find(
-                _store_instructions.begin(), _store_instructions.end(), store2
-            )
-        );
-        _swap_instructions.push_back(Swap(SwapPair(store1.interface().lock(), store2.interface().lock())));
-    } else {
-        //Mix two swaps
-        if (_swap_instructions.size() < 2) return;
-        Swap swap1 = _swap_instructions[static_cast<std::size_t>(rnd01()*_swap_instructions.size())];
-        _swap_instructions.erase(
-            std::find(
-                _swap_instructions.begin(), _swap_instructions.end(), swap1
-            )
-        );
-        Swap swap2 = _swap_instructions[static_cast<std::size_t>(rnd01()*_swap_instructions.size())];
-        _swap_instructions.erase(
-            std::find(
-                _swap_instructions.begin(), _swap_instructions.end(), swap2
-            )
-        );
-        if (rnd01() > 0.5) {
-            _swap_instructions.push_back(Swap(SwapPair(swap1.swap_pair().e1.lock(), swap2.swap_pair().e1.lock())));
-            _swap_instructions.push_back(Swap(SwapPair(swap1.swap_pair().e2.lock(), swap2.swap_pair().e2.lock())));
-        } else {
-            _swap_instructions.push_back(Swap(SwapPair(swap1.swap_pair().e1.lock(), swap2.swap_pair().e2.lock())));
-            _swap_instructions.push_back(Swap(SwapPair(swap1.swap_pair().e2.lock(), swap2.swap_pair().e1.lock())));
-        }
+void TimeSlot::canonicalize() {
+    for (Swap& swap : _swap_instructions) {
+        SwapPair pair = swap.swap_pair();
+        if (pair.e1.lock()->n_interface() > pair.e2.lock()->n_interface())
+            swap = Swap(SwapPair(pair.e2.lock(), pair.e1.lock()));
     }
+    std::sort(_swap_instructions.begin(), _swap_instructions.end(), [](const Swap& a, const Swap& b) {
+        return a.swap_pair().canonical_key() < b.swap_pair().canonical_key();
+    });
+    std::sort(_store_instructions.begin(), _store_instructions.end(), [](const Store& a, const Store& b) {
+        return a.interface().lock()->n_interface() < b.interface().lock()->n_interface();
+    });
+}
+
+std::vector<std::uint64_t> TimeSlot::canonical_keys() const {
+    std::vector<std::uint64_t> keys;
+    keys.reserve(_swap_instructions.size());
+    for (const Swap& swap : _swap_instructions)
+        keys.push_back(swap.swap_pair().canonical_key());
+    std::sort(keys.begin(), keys.end());
+    return keys;
 }
 
 void TimeSlot::print() const {
@@ -138,6 +117,13 @@ void InstructionTable::set_instruction_table(Node* context, nlohmann::json time_
     }
 }
 
+void InstructionTable::set_instruction_table(Node* context, const InstructionTable& other) {
+    _context = context;
+    _time_slots.reserve(other._time_slots.size());
+    for (const TimeSlot& time_slot : other._time_slots)
+        _time_slots.push_back(TimeSlot(_context, time_slot));
+}
+
 void InstructionTable::execute_swaps_next_time_slot() {
     if (_swaps_executed) return;
     _time_slots[_next_time_slot].execute_swaps();
@@ -163,38 +149,19 @@ void InstructionTable::reset(const std::vector<TimeSlot>& new_time_slots) {
         _time_slots.push_back(time_slot);
 }
 
-void InstructionTable::mutate(const std::function<double(void)>& rnd01) {
-    double action = rnd01();
-    if (action < 0.4) {
-        //Mutate time_slots
-        for (TimeSlot& time_slot : _time_slots)
-            if (rnd01() < 0.2)
-                time_slot.mutate(rnd01);
-    } else if (action < 0.7) {
-        //Add a new random time slot
-        std::vector<SwapPair> swap_instructions;
-        std::vector<std::shared_ptr<EntanglementInterface>> interfaces = _context->get_interfaces();
-
-        while (interfaces.size() > 1) {
-            std::shared_ptr<EntanglementInterface> interface = interfaces[static_cast<std::size_t>(rnd01() * interfaces.size())];
-            interfaces.erase(std::find(interfaces.begin(), interfaces.end(), interface));
-            if (rnd01() > 0.5) { //We create a Swap
-                std::shared_ptr<EntanglementInterface> interface2 = interfaces[static_cast<std::size_t>(rnd01() * interfaces.size())];
-                interfaces.erase(std::find(interfaces.begin(), interfaces.end(), interface2));
-                swap_instructions.push_back(SwapPair(interface, interface2));
-            }
-        }
+void InstructionTable::replace_time_slot(std::size_t n, const TimeSlot& time_slot) {
+    _time_slots[n] = TimeSlot(_context, time_slot);
+}
 
-        _time_slots.push_back(TimeSlot(_context, swap_instructions));
-    } else {
-        //We erase a time slot at random
-        if (_time_slots.size() == 1) {
-            _time_slots.clear();
-            _time_slots.push_back(TimeSlot(_context, std::vector<SwapPair>()));
-        } else 
-            _time_slots.erase(std::find(_time_slots.begin(), _time_slots.end(), _time_slots[static_cast<std::size_t>(rnd01() * _time_slots.size())]));
-    }
-       
+void InstructionTable::canonicalize(std::size_t period, std::size_t rotation) {
+    for (TimeSlot& time_slot : _time_slots)
+        time_slot.canonicalize();
+    if (period > 0 && period < _time_slots.size())
+        _time_slots.erase(_time_slots.begin() + period, _time_slots.end());
+    if (!_time_slots.empty())
+        std::rotate(_time_slots.begin(), _time_slots.begin() + rotation % _time_slots.size(), _time_slots.end());
+    _next_time_slot = 0;
+    _swaps_executed = false;
 }
 
 void InstructionTable::print() const {
@@ -1,85 +1,35 @@
 #include "network_model/network.hpp"
 
+#include "network_model/network_binary.hpp"
+#include "network_model/network_json_reader.hpp"
 #include "network_model/node.hpp"
 
 #include <algorithm>
 #include <cmath>
 #include <fstream>
+#include <numeric>
 #include <string>
+#include <unordered_map>
 #include <nlohmann/json.hpp>
 #include <iostream>
 
 static const LambdaCfg lambda_cfg{2.84777403440728, 0.6831071864140762}; //For the moment is harcoded
 
-Network::Network() {
-    using json = nlohmann::json;
-    std::ifstream json_config_file(network_topology_config_file);
-
-    json network_cfg = json::parse(json_config_file);
-
-    //Creates all nodes
-    _nodes.reserve(network_cfg["nodes"].size());
-    for (auto& element : network_cfg["nodes"].items()) {
-        _nodes.push_back(std::make_unique<Node>(Node(this, element.key())));
-        _nodes.back()->initialize_node(element.value());
-    }
+Network::Network(): Network(network_topology_config_file.c_str()) {
     //Emptying all instruction_tables
     for (std::unique_ptr<Node>& node : _nodes)
         node->reset_instruction_table(std::vector<TimeSlot>(1, TimeSlot(node.get(), std::vector<SwapPair>())));
-
-    //Initialize the pairs
-    std::size_t n_nodes = _nodes.size();
-    std::size_t n_pairs = n_nodes*(n_nodes - 1)/2;
-    
-    _node_pairs.reserve(n_pairs);
-    for (std::size_t i = 0; i < n_nodes - 1; ++i)
-    for (std::size_t j = i + 1; j < n_nodes; ++j) {
-            _node_pairs.push_back(NodePair{_nodes[i].get(), _nodes[j].get()});
-            _node_pair_weight[_node_pairs.back()] = lambda_cfg;
-            _shared_entanglement[_node_pairs.back()] = 0;
-        }
-    //Config all links
-    for (auto& element : network_cfg["links"].items()) {
-        Node* node1, * node2;
-        
-        std::string node1_name, node2_name;
-
-        std::istringstream link_name(element.key());
-        std::getline(link_name, node1_name, '-');
-        std::getline(link_name, node2_name);
-
-        for (const std::unique_ptr<Node>& node : _nodes) {
-            if (node->_node_name == node1_name)
-                node1 = node.get();
-
-            else if (node->_node_name == node2_name)
-                node2 = node.get();
-        }
-
-        std::string interface1, interface2;
-
-        std::istringstream interfaces(element.value()["interfaces"].get<std::string>());
-
-        std::getline(interfaces, interface1, '-');
-        std::getline(interfaces, interface2);
-        
-        pair((*node1)[std::stoul(interface1)], (*node2)[std::stoul(interface2)]);
-        (*node1)[std::stoul(interface1)]->reset_entangled_pair();
-        (*node2)[std::stoul(interface2)]->reset_entangled_pair();
-    }
 }
 
 Network::Network(const Network& other):
     _total_time_slots(other._total_time_slots),
     _time_slots_duration_nanoseconds(other._time_slots_duration_nanoseconds) {
-    
-    nlohmann::json network_cfg = other.to_json();
 
-    //Creates all nodes
-    _nodes.reserve(network_cfg["nodes"].size());
-    for (auto& element : network_cfg["nodes"].items()) {
-        _nodes.push_back(std::make_unique<Node>(Node(this, element.key())));
-        _nodes.back()->initialize_node(element.value());
+    //Creates all nodes, with their instruction tables rebound to the new interfaces
+    _nodes.reserve(other._nodes.size());
+    for (const std::unique_ptr<Node>& node : other._nodes) {
+        _nodes.push_back(std::make_unique<Node>(Node(this, node->_node_name)));
+        _nodes.back()->initialize_node(*node);
     }
 
     //Initialize the pairs
@@ -91,90 +41,31 @@ Network::Network(const Network& other):
             _node_pair_weight[_node_pairs.back()] = other._node_pair_weight.at(NodePair{other._nodes[i].get(), other._nodes[j].get()});
             _shared_entanglement[_node_pairs.back()] = other._shared_entanglement.at(NodePair{other._nodes[i].get(), other._nodes[j].get()});
         }
-    //Config all links
-    for (auto& element : network_cfg["links"].items()) {
-        Node* node1, * node2;
-        
-        std::string node1_name, node2_name;
-
-        std::istringstream link_name(element.key());
-        std::getline(link_name, node1_name, '-');
-        std::getline(link_name, node2_name);
-
-        for (const std::unique_ptr<Node>& node : _nodes) {
-            if (node->_node_name == node1_name)
-                node1 = node.get();
-
-            else if (node->_node_name == node2_name)
-                node2 = node.get();
+    //Config all links, each from the end on the node that comes first
+    std::unordered_map<const Node*, std::size_t> node_index;
+    for (std::size_t i = 0; i < n_nodes; ++i)
+        node_index[other._nodes[i].get()] = i;
+    for (std::size_t i = 0; i < n_nodes; ++i)
+        for (const std::shared_ptr<EntanglementInterface>& interface : other._nodes[i]->get_interfaces()) {
+            std::shared_ptr<EntanglementInterface> fibre = interface->fibre_pair().lock();
+            if (!fibre) continue;
+            std::size_t j = node_index.at(fibre->context());
+            if (j < i || (j == i && fibre->n_interface() < interface->n_interface())) continue;
+
+            std::shared_ptr<EntanglementInterface> e1 = (*_nodes[i])[interface->n_interface()], e2 = (*_nodes[j])[fibre->n_interface()];
+            pair(e1, e2);
+            e1->reset_entangled_pair();
+            e2->reset_entangled_pair();
         }
-
-        std::string interface1, interface2;
-
-        std::istringstream interfaces(element.value()["interfaces"].get<std::string>());
-
-        std::getline(interfaces, interface1, '-');
-        std::getline(interfaces, interface2);
-        
-        pair((*node1)[std::stoul(interface1)], (*node2)[std::stoul(interface2)]);
-        (*node1)[std::stoul(interface1)]->reset_entangled_pair();
-        (*node2)[std::stoul(interface2)]->reset_entangled_pair();
-    }
 }
 
 Network::Network(const char* config_json_file) {
-    using json = nlohmann::json;
-    std::ifstream json_config_file(config_json_file);
-
-    json network_cfg = json::parse(json_config_file);
-
-    //Creates all nodes
-    _nodes.reserve(network_cfg["nodes"].size());
-    for (auto& element : network_cfg["nodes"].items()) {
-        _nodes.push_back(std::make_unique<Node>(Node(this, element.key())));
-        _nodes.back()->initialize_node(element.value());
-    }
-
-    //Initialize the pairs
-    std::size_t n_nodes = _nodes.size();
-    std::size_t n_pairs = n_nodes*(n_nodes - 1)/2;
-    _node_pairs.reserve(n_pairs);
-    for (std::size_t i = 0; i < n_nodes - 1; ++i)
-    for (std::size_t j = i + 1; j < n_nodes; ++j) {
-            _node_pairs.push_back(NodePair{_nodes[i].get(), _nodes[j].get()});
-            _node_pair_weight[_node_pairs.back()] = lambda_cfg;
-            _shared_entanglement[_node_pairs.back()] = 0;
-        }
-    //Config all links
-    for (auto& element : network_cfg["links"].items()) {
-        Node* node1, * node2;
-        
-        std::string node1_name, node2_name;
-
-        std::istringstream link_name(element.key());
-        std::getline(link_name, node1_name, '-');
-        std::getline(link_name, node2_name);
-
-        for (const std::unique_ptr<Node>& node : _nodes) {
-            if (node->_node_name == node1_name)
-                node1 = node.get();
-
-            else if (node->_node_name == node2_name)
-                node2 = node.get();
-        }
-
-        std::string interface1, interface2;
-
-        std::istringstream interfaces(element.value()["interfaces"].get<std::string>());
-
-        std::getline(interfaces, interface1, '-');
-        std::getline(interfaces, interface2);
-        
-        pair((*node1)[std::stoul(interface1)], (*node2)[std::stoul(interface2)]);
-        (*node1)[std::stoul(interface1)]->reset_entangled_pair();
-        (*node2)[std::stoul(interface2)]->reset_entangled_pair();
+    if (NetworkBinaryFile::is_binary(config_json_file)) {
+        *this = Network(NetworkBinaryFile(config_json_file).description());
+        return;
     }
-
+    std::ifstream json_config_file(config_json_file);
+    *this = Network(NetworkJsonReader().read(json_config_file));
 }
 
 Network::Network(nlohmann::json config_json) {
@@ -227,92 +118,73 @@ Network::Network(nlohmann::json config_json) {
     }
 }
 
-Network& Network::operator=(const Network& other) {
+Network::Network(const NetworkDescription& description) {
+    const std::uint32_t* offsets = description.name_offsets;
+    for (std::size_t i = 0; i < description.n_nodes; ++i)
+        if (offsets[i] > offsets[i + 1] || offsets[i + 1] > description.names_size)
+            throw "Node name out of the network description";
 
-    _total_time_slots = other._total_time_slots;
-    _time_slots_duration_nanoseconds = other._time_slots_duration_nanoseconds;
-
-    nlohmann::json network_cfg = other.to_json();
-    
     //Creates all nodes
-    _nodes.clear();
-    _nodes.reserve(network_cfg["nodes"].size());
-    for (auto& element : network_cfg["nodes"].items()) {
-        _nodes.push_back(std::make_unique<Node>(Node(this, element.key())));
-        _nodes.back()->initialize_node(element.value());
+    _nodes.reserve(description.n_nodes);
+    for (std::size_t i = 0; i < description.n_nodes; ++i) {
+        _nodes.push_back(std::make_unique<Node>(Node(this, std::string(description.names + offsets[i], offsets[i + 1] - offsets[i]))));
+        _nodes.back()->initialize_node(description.n_interfaces[i], description.swap_probabilities[i]);
     }
 
-    //Initialize the pairs
+    //Initialize the pairs, in key order when the nodes are sorted by name
     std::size_t n_nodes = _nodes.size();
-    _node_pairs.clear();
     _node_pairs.reserve(n_nodes*(n_nodes - 1)/2);
-    _node_pair_weight.clear();
-    _shared_entanglement.clear();
-    for (std::size_t i = 0; i < n_nodes - 1; ++i)
+    for (std::size_t i = 0; i + 1 < n_nodes; ++i)
     for (std::size_t j = i + 1; j < n_nodes; ++j) {
             _node_pairs.push_back(NodePair{_nodes[i].get(), _nodes[j].get()});
-            _node_pair_weight[_node_pairs.back()] = other._node_pair_weight.at(NodePair{other._nodes[i].get(), other._nodes[j].get()});
-            _shared_entanglement[_node_pairs.back()] = other._shared_entanglement.at(NodePair{other._nodes[i].get(), other._nodes[j].get()});
+            _node_pair_weight.emplace_hint(_node_pair_weight.end(), _node_pairs.back(), lambda_cfg);
+            _shared_entanglement.emplace_hint(_shared_entanglement.end(), _node_pairs.back(), 0);
         }
     //Config all links
-    for (auto& element : network_cfg["links"].items()) {
-        Node* node1, * node2;
-        
-        std::string node1_name, node2_name;
-
-        std::istringstream link_name(element.key());
-        std::getline(link_name, node1_name, '-');
-        std::getline(link_name, node2_name);
-
-        for (const std::unique_ptr<Node>& node : _nodes) {
-            if (node->_node_name == node1_name)
-                node1 = node.get();
-
-            else if (node->_node_name == node2_name)
-                node2 = node.get();
-        }
-
-        std::string interface1, interface2;
-
-        std::istringstream interfaces(element.value()["interfaces"].get<std::string>());
-
-        std::getline(interfaces, interface1, '-');
-        std::getline(interfaces, interface2);
-        
-        pair((*node1)[std::stoul(interface1)], (*node2)[std::stoul(interface2)]);
-        (*node1)[std::stoul(interface1)]->reset_entangled_pair();
-        (*node2)[std::stoul(interface2)]->reset_entangled_pair();
+    for (std::size_t n = 0; n < description.n_links; ++n) {
+        const std::uint32_t* link = description.links + 4*n;
+        if (link[0] >= n_nodes || link[2] >= n_nodes
+         || link[1] >= _nodes[link[0]]->n_interfaces() || link[3] >= _nodes[link[2]]->n_interfaces())
+            throw "Link to a missing interface in the network description";
+        std::shared_ptr<EntanglementInterface> e1 = (*_nodes[link[0]])[link[1]], e2 = (*_nodes[link[2]])[link[3]];
+        pair(e1, e2);
+        e1->reset_entangled_pair();
+        e2->reset_entangled_pair();
     }
 
-    return *this;
+    decode_instruction_tables(description.genome, description.n_genome_words);
 }
 
-void Network::init_network_random_instruction_tables(const std::function<double(void)>& rnd01) {
-    for (std::unique_ptr<Node>& node : _nodes) {
-        std::size_t n_time_slots = static_cast<std::size_t>(rnd01() * 9) + 1;
-        std::vector<TimeSlot> time_slots;
-        time_slots.reserve(n_time_slots);
-        
-        for (std::size_t i_time_slot = 0; i_time_slot < n_time_slots; ++i_time_slot) {
-            std::vector<std::shared_ptr<EntanglementInterface>> interfaces = node->get_interfaces();
-            std::vector<SwapPair> swap_instructions;
-
-            while (interfaces.size() > 1) {
-                std::size_t interface_n = static_cast<std::size_t>(rnd01() * interfaces.size());
-                std::shared_ptr<EntanglementInterface> interface = interfaces[interface_n];
-                interfaces.erase(std::find(interfaces.begin(), interfaces.end(), interface));
-                if (rnd01() > 0.3) { //We create a Swap
-                    std::shared_ptr<EntanglementInterface> interface2 = interfaces[static_cast<std::size_t>(rnd01() * interfaces.size())];
-                    interfaces.erase(std::find(interfaces.begin(), interfaces.end(), interface2));
-                    swap_instructions.push_back(SwapPair(interface, interface2));
-                }
-            }
+// Nodes stay where they are on the heap, only their back-pointer follows the move
+Network::Network(Network&& other):
+    _nodes(std::move(other._nodes)),
+    _node_pairs(std::move(other._node_pairs)),
+    _node_pair_weight(std::move(other._node_pair_weight)),
+    _shared_entanglement(std::move(other._shared_entanglement)),
+    _total_time_slots(other._total_time_slots),
+    _time_slots_duration_nanoseconds(other._time_slots_duration_nanoseconds) {
+    for (std::unique_ptr<Node>& node : _nodes)
+        node->rebind_network(this);
+}
 
-            time_slots.push_back(TimeSlot(node.get(), swap_instructions));
-        }
+Network& Network::operator=(Network&& other) {
+    if (this == &other)
+        return *this;
+    _nodes = std::move(other._nodes);
+    _node_pairs = std::move(other._node_pairs);
+    _node_pair_weight = std::move(other._node_pair_weight);
+    _shared_entanglement = std::move(other._shared_entanglement);
+    _total_time_slots = other._total_time_slots;
+    _time_slots_duration_nanoseconds = other._time_slots_duration_nanoseconds;
+    for (std::unique_ptr<Node>& node : _nodes)
+        node->rebind_network(this);
+    return *this;
+}
 
-        node->reset_instruction_table(time_slots);
-    }
+Network& Network::operator=(const Network& other) {
+    if (this != &other)
+        *this = Network(other);
+    return *this;
 }
 
 void Network::add_shared_entanglement(NodePair&& node_pair, double entanglement) const {
@@ -335,11 +207,12 @@ void Network::reset() const {
     _total_time_slots = 0;
 }
 
-void Network::mutate(const std::function<double(void)>& rnd01) {
-    for (std::unique_ptr<Node>& node : _nodes) {
-        if (rnd01() < 0.8)
-            node->mutate(rnd01);
-    }
+void Network::copy_instruction_table(std::size_t node, const Network& other) {
+    _nodes[node]->copy_instruction_table(*other._nodes[node]);
+}
+
+void Network::copy_time_slot(std::size_t node, std::size_t n, const Network& other, std::size_t other_n) {
+    _nodes[node]->copy_time_slot(n, *other._nodes[node], other_n);
 }
 
 double Network::amount_entanglement() const {
@@ -402,6 +275,137 @@ nlohmann::json Network::to_json() const {
     return network_json;
 }
 
+void Network::encode_instruction_tables(std::vector<std::uint32_t>& words) const {
+    words.clear();
+    for (const std::unique_ptr<Node>& node : _nodes) {
+        words.push_back(static_cast<std::uint32_t>(node->time_slots().size()));
+        for (const TimeSlot& time_slot : node->time_slots()) {
+            words.push_back(static_cast<std::uint32_t>(time_slot.swap_instructions().size()));
+            for (const Swap& swap : time_slot.swap_instructions()) {
+                SwapPair pair = swap.swap_pair();
+                words.push_back(static_cast<std::uint32_t>(pair.e1.lock()->n_interface()));
+                words.push_back(static_cast<std::uint32_t>(pair.e2.lock()->n_interface()));
+            }
+        }
+    }
+}
+
+void Network::decode_instruction_tables(const std::uint32_t* words, std::size_t n_words) {
+    std::size_t position = 0;
+    auto next_word = [&]() {
+        if (position >= n_words)
+            throw "Truncated instruction tables";
+        return words[position++];
+    };
+
+    for (std::unique_ptr<Node>& node : _nodes) {
+        std::vector<TimeSlot> time_slots;
+        std::uint32_t n_time_slots = next_word();
+        for (std::uint32_t i_time_slot = 0; i_time_slot < n_time_slots; ++i_time_slot) {
+            std::vector<SwapPair> swap_instructions;
+            std::vector<bool> used(node->n_interfaces(), false);
+            std::uint32_t n_swaps = next_word();
+            for (std::uint32_t i_swap = 0; i_swap < n_swaps; ++i_swap) {
+                std::uint32_t e1 = next_word(), e2 = next_word();
+                if (e1 >= node->n_interfaces() || e2 >= node->n_interfaces() || e1 == e2 || used[e1] || used[e2])
+                    throw "Invalid swap in instruction tables";
+                used[e1] = used[e2] = true;
+                swap_instructions.push_back(SwapPair((*node)[e1], (*node)[e2]));
+            }
+            time_slots.push_back(TimeSlot(node.get(), swap_instructions));
+        }
+        node->reset_instruction_table(time_slots);
+    }
+    if (position != n_words)
+        throw "Trailing words after instruction tables";
+}
+
+Network::CanonicalForm Network::canonical_form() const {
+    CanonicalForm form;
+    form.slot_keys.reserve(_nodes.size());
+    form.periods.reserve(_nodes.size());
+    form.rotations.reserve(_nodes.size());
+
+    // Shortest cycle that repeats to the whole table
+    for (const std::unique_ptr<Node>& node : _nodes) {
+        std::vector<std::vector<std::uint64_t>> keys;
+        keys.reserve(node->time_slots().size());
+        for (const TimeSlot& time_slot : node->time_slots())
+            keys.push_back(time_slot.canonical_keys());
+
+        std::size_t period = std::max<std::size_t>(keys.size(), 1);
+        for (std::size_t p = 1; p < keys.size(); ++p) {
+            if (keys.size() % p != 0) continue;
+            bool repeats = true;
+            for (std::size_t i = p; i < keys.size() && repeats; ++i)
+                repeats = keys[i] == keys[i - p];
+            if (repeats) {
+                period = p;
+                break;
+            }
+        }
+        keys.resize(std::min(keys.size(), period));
+        form.slot_keys.push_back(std::move(keys));
+        form.periods.push_back(period);
+    }
+
+    // Every node advances one slot per step, so only a common rotation s (node i starts at
+    // s mod period_i) keeps the schedule. Pick the lexicographically least one node by node:
+    // once the first nodes are fixed, s can only move in multiples of the lcm of their periods.
+    std::uint64_t shift = 0, step = 1;
+    for (std::size_t n = 0; n < _nodes.size(); ++n) {
+        const std::vector<std::vector<std::uint64_t>>& keys = form.slot_keys[n];
+        std::uint64_t period = keys.size();
+        if (period <= 1) {
+            form.rotations.push_back(0);
+            continue;
+        }
+        std::uint64_t first = shift % period, stride = step % period;
+        std::uint64_t n_candidates = period / std::gcd(stride, period);
+        std::uint64_t best = 0;
+        for (std::uint64_t k = 1; k < n_candidates; ++k) {
+            std::uint64_t a = (first + k*stride) % period, b = (first + best*stride) % period;
+            for (std::uint64_t i = 0; i < period; ++i) {
+                const std::vector<std::uint64_t>& slot_a = keys[(a + i) % period];
+                const std::vector<std::uint64_t>& slot_b = keys[(b + i) % period];
+                if (slot_a == slot_b) continue;
+                if (slot_a < slot_b) best = k;
+                break;
+            }
+        }
+        form.rotations.push_back((first + best*stride) % period);
+
+        // Past 2^32 the common period is no longer tracked and later nodes just follow `shift`
+        shift += best*step;
+        step = step / std::gcd(step, period) * period;
+        if (step >= (std::uint64_t(1) << 32))
+            step = 0;
+    }
+    return form;
+}
+
+void Network::canonicalize() {
+    CanonicalForm form = canonical_form();
+    for (std::size_t n = 0; n < _nodes.size(); ++n)
+        _nodes[n]->canonicalize_instruction_table(form.periods[n], form.rotations[n]);
+}
+
+Hash128 Network::genome_hash() const {
+    CanonicalForm form = canonical_form();
+    Hasher128 hasher;
+    for (std::size_t n = 0; n < _nodes.size(); ++n) {
+        const std::vector<std::vector<std::uint64_t>>& keys = form.slot_keys[n];
+        hasher.add(keys.size());
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+            const std::vector<std::uint64_t>& slot = keys[(form.rotations[n] + i) % keys.size()];
+            hasher.add(slot.size());
+            for (std::uint64_t key : slot)
+                hasher.add(key);
+        }
+    }
+    return hasher.finish();
+}
+
 void Network::print() const {
     for (const std::unique_ptr<Node>& node : _nodes)
         node->print();
@@ -0,0 +1,161 @@
+#include "network_model/network_binary.hpp"
+
+#include "network_model/entanglement_interface.hpp"
+#include "network_model/node.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+struct FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint64_t n_nodes;
+    std::uint64_t names_size;
+    std::uint64_t n_links;
+    std::uint64_t n_genome_words;
+};
+static_assert(sizeof(FileHeader) == 48, "Network file header must be 48 bytes");
+
+constexpr char file_magic[8] = {'C', 'N', 'A', 'N', 'E', 'T', 'W', 'K'};
+constexpr std::uint32_t byte_order_mark = 0x01020304;
+
+std::size_t aligned(std::size_t position) {
+    return (position + 7) & ~std::size_t(7);
+}
+
+// The next array of count*width elements of the mapping, past position
+template<typename T>
+const T* map_array(const char* data, std::size_t size, std::size_t& position, std::uint64_t count, std::size_t width = 1) {
+    position = aligned(position);
+    if (position > size || count > (size - position)/(sizeof(T)*width))
+        throw "Truncated network file";
+    const T* array = reinterpret_cast<const T*>(data + position);
+    position += count*width*sizeof(T);
+    return array;
+}
+
+template<typename T>
+void write_array(std::ofstream& file, const std::vector<T>& array) {
+    static const char padding[8] = {};
+    file.write(reinterpret_cast<const char*>(array.data()), static_cast<std::streamsize>(array.size()*sizeof(T)));
+    std::size_t size = array.size()*sizeof(T);
+    file.write(padding, static_cast<std::streamsize>(aligned(size) - size));
+}
+
+}
+
+NetworkBinaryFile::NetworkBinaryFile(const char* path) {
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw "Cannot open network file";
+    struct stat file_status;
+    if (fstat(fd, &file_status) != 0 || static_cast<std::size_t>(file_status.st_size) < sizeof(FileHeader)) {
+        ::close(fd);
+        throw "Not a network file";
+    }
+    _size = static_cast<std::size_t>(file_status.st_size);
+    _data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (_data == MAP_FAILED) {
+        _data = nullptr;
+        throw "Cannot map network file";
+    }
+
+    try {
+        const char* data = static_cast<const char*>(_data);
+        FileHeader header;
+        std::memcpy(&header, data, sizeof(header));
+        if (std::memcmp(header.magic, file_magic, sizeof(file_magic)) != 0 || header.version != version)
+            throw "Not a network file of this version";
+        if (header.byte_order != byte_order_mark)
+            throw "Network file written with another byte order";
+
+        std::size_t position = sizeof(header);
+        _description.n_nodes = header.n_nodes;
+        _description.swap_probabilities = map_array<double>(data, _size, position, header.n_nodes);
+        _description.name_offsets = map_array<std::uint32_t>(data, _size, position, header.n_nodes + 1);
+        _description.n_interfaces = map_array<std::uint32_t>(data, _size, position, header.n_nodes);
+        _description.n_links = header.n_links;
+        _description.links = map_array<std::uint32_t>(data, _size, position, header.n_links, 4);
+        _description.n_genome_words = header.n_genome_words;
+        _description.genome = map_array<std::uint32_t>(data, _size, position, header.n_genome_words);
+        _description.names_size = header.names_size;
+        _description.names = map_array<char>(data, _size, position, header.names_size);
+    } catch (...) {
+        munmap(_data, _size);
+        _data = nullptr;
+        throw;
+    }
+}
+
+NetworkBinaryFile::~NetworkBinaryFile() {
+    if (_data)
+        munmap(_data, _size);
+}
+
+bool NetworkBinaryFile::is_binary(const char* path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(file_magic)];
+    return file.read(magic, sizeof(magic)) && std::memcmp(magic, file_magic, sizeof(magic)) == 0;
+}
+
+void NetworkBinaryFile::write(const char* path, const Network& network) {
+    const std::vector<std::unique_ptr<Node>>& nodes = network.nodes();
+    std::unordered_map<const Node*, std::uint32_t> node_index;
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+        node_index[nodes[i].get()] = static_cast<std::uint32_t>(i);
+
+    std::string names;
+    std::vector<std::uint32_t> name_offsets(1, 0), n_interfaces, links, genome;
+    std::vector<double> swap_probabilities;
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        const Node& node = *nodes[i];
+        names += node._node_name;
+        name_offsets.push_back(static_cast<std::uint32_t>(names.size()));
+        n_interfaces.push_back(static_cast<std::uint32_t>(node.n_interfaces()));
+        swap_probabilities.push_back(node.swap_probability());
+
+        //Each link from the end on the node that comes first
+        for (const std::shared_ptr<EntanglementInterface>& interface : node.get_interfaces()) {
+            std::shared_ptr<EntanglementInterface> fibre = interface->fibre_pair().lock();
+            if (!fibre) continue;
+            std::uint32_t j = node_index.at(fibre->context());
+            if (j < i || (j == i && fibre->n_interface() < interface->n_interface())) continue;
+            links.insert(links.end(), {
+                static_cast<std::uint32_t>(i), static_cast<std::uint32_t>(interface->n_interface()),
+                j, static_cast<std::uint32_t>(fibre->n_interface())
+            });
+        }
+    }
+    network.encode_instruction_tables(genome);
+
+    FileHeader header{};
+    std::memcpy(header.magic, file_magic, sizeof(file_magic));
+    header.version = version;
+    header.byte_order = byte_order_mark;
+    header.n_nodes = nodes.size();
+    header.names_size = names.size();
+    header.n_links = links.size()/4;
+    header.n_genome_words = genome.size();
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_array(file, swap_probabilities);
+    write_array(file, name_offsets);
+    write_array(file, n_interfaces);
+    write_array(file, links);
+    write_array(file, genome);
+    file.write(names.data(), static_cast<std::streamsize>(names.size()));
+    if (!file)
+        throw "Cannot write network file";
+}
@@ -0,0 +1,333 @@
+#include "network_model/network_json_reader.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <nlohmann/json.hpp>
+
+namespace {
+
+enum class Context { Root, Nodes, Node, TimeSlots, TimeSlot, Links, Link };
+
+// What the value after the last key, or the whole document, stands for
+enum class Field { Document, Ignored, Nodes, Links, Node, Interfaces, SwapProbability, TimeSlots, Link, LinkInterfaces };
+
+// "a-b" split as the document loaders do: at the first '-', then up to a newline
+void split_pair(const std::string& text, std::string& first, std::string& second) {
+    std::size_t dash = text.find('-');
+    first = text.substr(0, dash);
+    if (dash == std::string::npos)
+        second.clear();
+    else
+        second = text.substr(dash + 1, text.find('\n', dash + 1) - dash - 1);
+}
+
+std::uint32_t parse_interface(const std::string& text) {
+    try {
+        unsigned long value = std::stoul(text);
+        if (value <= std::numeric_limits<std::uint32_t>::max())
+            return static_cast<std::uint32_t>(value);
+    } catch (const std::logic_error&) {}
+    throw "Invalid interface number in network configuration";
+}
+
+}
+
+class NetworkJsonReader::Handler {
+public:
+    using json = nlohmann::json;
+
+    explicit Handler(NetworkJsonReader& reader): _reader(reader) {}
+
+    bool null() {
+        if (_skip_depth > 0)
+            return true;
+        if (in_array()) {
+            if (_contexts.back() != Context::TimeSlots)
+                unexpected();
+            add_time_slot();
+            return true;
+        }
+        switch (_field) {
+            case Field::Nodes: case Field::Links: case Field::Ignored:
+                return true;
+            case Field::TimeSlots:
+                _reader._nodes[_node].instruction_table.assign(1, 0);
+                return true;
+            default:
+                unexpected();
+        }
+    }
+
+    bool boolean(bool) { return ignored(); }
+    bool binary(json::binary_t&) { return ignored(); }
+    bool number_integer(json::number_integer_t value) { return number(static_cast<double>(value)); }
+    bool number_unsigned(json::number_unsigned_t value) { return number(static_cast<double>(value)); }
+    bool number_float(json::number_float_t value, const json::string_t&) { return number(value); }
+
+    bool string(json::string_t& value) {
+        if (_skip_depth > 0)
+            return true;
+        if (in_array()) {
+            if (_contexts.back() != Context::TimeSlot)
+                unexpected();
+            std::string interface1, interface2;
+            split_pair(value, interface1, interface2);
+            std::vector<std::uint32_t>& table = _reader._nodes[_node].instruction_table;
+            ++table[_slot_position];
+            table.push_back(parse_interface(interface1));
+            table.push_back(parse_interface(interface2));
+            return true;
+        }
+        if (_field == Field::Ignored)
+            return true;
+        if (_field != Field::LinkInterfaces)
+            unexpected();
+        std::string interface1, interface2;
+        split_pair(value, interface1, interface2);
+        ParsedLink& link = _reader._links.back();
+        link.interface1 = parse_interface(interface1);
+        link.interface2 = parse_interface(interface2);
+        link.has_interfaces = true;
+        return true;
+    }
+
+    bool start_object(std::size_t) {
+        if (_skip_depth > 0) {
+            ++_skip_depth;
+            return true;
+        }
+        if (in_array())
+            unexpected();
+        switch (_field) {
+            case Field::Document: _contexts.push_back(Context::Root); break;
+            case Field::Nodes: _contexts.push_back(Context::Nodes); break;
+            case Field::Links: _contexts.push_back(Context::Links); break;
+            case Field::Link: _contexts.push_back(Context::Link); break;
+            case Field::Ignored: _skip_depth = 1; break;
+            case Field::Node: {
+                // A repeated node replaces the earlier one
+                ParsedNode& node = _reader._nodes[_node];
+                node.defined = true;
+                node.has_interfaces = node.has_swap_probability = false;
+                node.instruction_table.assign(1, 0);
+                _contexts.push_back(Context::Node);
+                break;
+            }
+            default:
+                unexpected();
+        }
+        return true;
+    }
+
+    bool key(json::string_t& value) {
+        if (_skip_depth > 0)
+            return true;
+        switch (_contexts.back()) {
+            case Context::Root:
+                _field = value == "nodes"? Field::Nodes : value == "links"? Field::Links : Field::Ignored;
+                break;
+            case Context::Nodes:
+                _node = _reader.intern(value);
+                _field = Field::Node;
+                break;
+            case Context::Node:
+                _field = value == "entanglement_interfaces"? Field::Interfaces
+                    : value == "swap_probability"? Field::SwapProbability
+                    : value == "time_slots"? Field::TimeSlots : Field::Ignored;
+                break;
+            case Context::Links: {
+                std::string node1, node2;
+                split_pair(value, node1, node2);
+                ParsedLink link;
+                link.key = value;
+                link.node1 = _reader.intern(node1);
+                link.node2 = _reader.intern(node2);
+                _reader._links.push_back(std::move(link));
+                _field = Field::Link;
+                break;
+            }
+            case Context::Link:
+                _field = value == "interfaces"? Field::LinkInterfaces : Field::Ignored;
+                break;
+            default:
+                break;
+        }
+        return true;
+    }
+
+    bool end_object() {
+        if (_skip_depth > 0) {
+            --_skip_depth;
+            return true;
+        }
+        if (_contexts.back() == Context::Node) {
+            const ParsedNode& node = _reader._nodes[_node];
+            if (!node.has_interfaces || !node.has_swap_probability)
+                throw "Node without entanglement_interfaces or swap_probability in network configuration";
+        } else if (_contexts.back() == Context::Link && !_reader._links.back().has_interfaces)
+            throw "Link without interfaces in network configuration";
+        _contexts.pop_back();
+        return true;
+    }
+
+    bool start_array(std::size_t) {
+        if (_skip_depth > 0) {
+            ++_skip_depth;
+            return true;
+        }
+        if (in_array()) {
+            if (_contexts.back() != Context::TimeSlots)
+                unexpected();
+            add_time_slot();
+            _contexts.push_back(Context::TimeSlot);
+            return true;
+        }
+        if (_field == Field::Ignored)
+            _skip_depth = 1;
+        else if (_field == Field::TimeSlots) {
+            _reader._nodes[_node].instruction_table.assign(1, 0);
+            _contexts.push_back(Context::TimeSlots);
+        } else
+            unexpected();
+        return true;
+    }
+
+    bool end_array() {
+        if (_skip_depth > 0)
+            --_skip_depth;
+        else
+            _contexts.pop_back();
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) {
+        throw "Malformed JSON network configuration";
+    }
+
+private:
+    NetworkJsonReader& _reader;
+    std::vector<Context> _contexts;
+    Field _field = Field::Document;
+    std::size_t _skip_depth = 0;    // nesting inside an ignored value
+    std::uint32_t _node = 0;        // the node being read
+    std::size_t _slot_position = 0; // of the swap count of the time slot being read
+
+    [[noreturn]] static void unexpected() {
+        throw "Unexpected value in network configuration";
+    }
+
+    bool in_array() const {
+        return !_contexts.empty() && (_contexts.back() == Context::TimeSlots || _contexts.back() == Context::TimeSlot);
+    }
+
+    bool ignored() const {
+        if (_skip_depth == 0 && (in_array() || _field != Field::Ignored))
+            unexpected();
+        return true;
+    }
+
+    bool number(double value) {
+        if (_skip_depth > 0)
+            return true;
+        if (in_array())
+            unexpected();
+        switch (_field) {
+            case Field::Ignored:
+                break;
+            case Field::Interfaces:
+                if (!(value >= 0 && value <= std::numeric_limits<std::uint32_t>::max()))
+                    throw "Invalid number of entanglement interfaces in network configuration";
+                _reader._nodes[_node].n_interfaces = static_cast<std::uint32_t>(value);
+                _reader._nodes[_node].has_interfaces = true;
+                break;
+            case Field::SwapProbability:
+                _reader._nodes[_node].swap_probability = value;
+                _reader._nodes[_node].has_swap_probability = true;
+                break;
+            default:
+                unexpected();
+        }
+        return true;
+    }
+
+    void add_time_slot() {
+        std::vector<std::uint32_t>& table = _reader._nodes[_node].instruction_table;
+        ++table[0];
+        _slot_position = table.size();
+        table.push_back(0);
+    }
+};
+
+const NetworkDescription& NetworkJsonReader::read(std::istream& input) {
+    _nodes.clear();
+    _node_index.clear();
+    _links.clear();
+
+    Handler handler(*this);
+    nlohmann::json::sax_parse(input, &handler);
+    describe();
+    return _description;
+}
+
+std::uint32_t NetworkJsonReader::intern(const std::string& name) {
+    std::unordered_map<std::string, std::uint32_t>::iterator it = _node_index.find(name);
+    if (it != _node_index.end())
+        return it->second;
+    std::uint32_t index = static_cast<std::uint32_t>(_nodes.size());
+    _node_index.emplace(name, index);
+    _nodes.emplace_back();
+    _nodes.back().name = name;
+    return index;
+}
+
+void NetworkJsonReader::describe() {
+    for (const ParsedNode& node : _nodes)
+        if (!node.defined)
+            throw "Link to a node missing from the network configuration";
+
+    std::vector<std::uint32_t> order(_nodes.size()), position(_nodes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](std::uint32_t i, std::uint32_t j) {
+        return _nodes[i].name < _nodes[j].name;
+    });
+
+    _names.clear();
+    _name_offsets.assign(1, 0);
+    _n_interfaces.clear();
+    _swap_probabilities.clear();
+    _genome.clear();
+    for (std::size_t k = 0; k < order.size(); ++k) {
+        const ParsedNode& node = _nodes[order[k]];
+        position[order[k]] = static_cast<std::uint32_t>(k);
+        _names += node.name;
+        _name_offsets.push_back(static_cast<std::uint32_t>(_names.size()));
+        _n_interfaces.push_back(node.n_interfaces);
+        _swap_probabilities.push_back(node.swap_probability);
+        _genome.insert(_genome.end(), node.instruction_table.begin(), node.instruction_table.end());
+    }
+
+    std::stable_sort(_links.begin(), _links.end(), [](const ParsedLink& link1, const ParsedLink& link2) {
+        return link1.key < link2.key;
+    });
+    _link_words.clear();
+    for (std::size_t i = 0; i < _links.size(); ++i) {
+        const ParsedLink& link = _links[i];
+        if (i + 1 < _links.size() && _links[i + 1].key == link.key)
+            continue;
+        _link_words.insert(_link_words.end(), {position[link.node1], link.interface1, position[link.node2], link.interface2});
+    }
+
+    _description = NetworkDescription();
+    _description.n_nodes = _nodes.size();
+    _description.names = _names.data();
+    _description.names_size = _names.size();
+    _description.name_offsets = _name_offsets.data();
+    _description.n_interfaces = _n_interfaces.data();
+    _description.swap_probabilities = _swap_probabilities.data();
+    _description.n_links = _link_words.size()/4;
+    _description.links = _link_words.data();
+    _description.n_genome_words = _genome.size();
+    _description.genome = _genome.data();
+}
@@ -0,0 +1,189 @@
+#include "network_model/network_json_writer.hpp"
+
+#include "network_model/entanglement_interface.hpp"
+#include "network_model/node.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <utility>
+#include <nlohmann/json.hpp>
+
+// Compares "first1-second1" with "first2-second2" as strings, without concatenating them
+static int compare_link_keys(const std::string& first1, const std::string& second1, const std::string& first2, const std::string& second2) {
+    std::size_t length1 = first1.size() + 1 + second1.size(), length2 = first2.size() + 1 + second2.size();
+    auto at = [](const std::string& first, const std::string& second, std::size_t i) {
+        return static_cast<unsigned char>(i < first.size()? first[i] : i == first.size()? '-' : second[i - first.size() - 1]);
+    };
+    for (std::size_t i = 0; i < std::min(length1, length2); ++i) {
+        unsigned char c1 = at(first1, second1, i), c2 = at(first2, second2, i);
+        if (c1 != c2)
+            return c1 < c2? -1 : 1;
+    }
+    return length1 < length2? -1 : length1 > length2? 1 : 0;
+}
+
+const std::string& NetworkJsonWriter::write(const Network& network) {
+    _buffer.clear();
+    const std::vector<std::unique_ptr<Node>>& nodes = network.nodes();
+    if (nodes.empty()) {
+        _buffer += "null";
+        return _buffer;
+    }
+
+    collect_links(network);
+    bool has_interfaces = !_links.empty();
+    std::sort(_links.begin(), _links.end(), [](const Link& link1, const Link& link2) {
+        return compare_link_keys(link1.node1->_node_name, link1.node2->_node_name, link2.node1->_node_name, link2.node2->_node_name) < 0;
+    });
+
+    _buffer += '{';
+    if (has_interfaces) {
+        _buffer += "\"links\":{";
+        for (std::size_t i = 0; i < _links.size(); ++i) {
+            const Link& link = _links[i];
+            if (i > 0)
+                _buffer += ',';
+            _buffer += '"';
+            write_string(link.node1->_node_name);
+            _buffer += '-';
+            write_string(link.node2->_node_name);
+            _buffer += "\":{\"interfaces\":\"";
+            write_unsigned(link.interface1);
+            _buffer += '-';
+            write_unsigned(link.interface2);
+            _buffer += "\"}";
+        }
+        _buffer += "},";
+    }
+
+    _sorted_nodes.clear();
+    for (const std::unique_ptr<Node>& node : nodes)
+        _sorted_nodes.push_back(node.get());
+    std::sort(_sorted_nodes.begin(), _sorted_nodes.end(), [](const Node* node1, const Node* node2) {
+        return node1->_node_name < node2->_node_name;
+    });
+
+    _buffer += "\"nodes\":{";
+    for (std::size_t i = 0; i < _sorted_nodes.size(); ++i) {
+        const Node* node = _sorted_nodes[i];
+        if (i > 0)
+            _buffer += ',';
+        _buffer += '"';
+        write_string(node->_node_name);
+        _buffer += "\":{\"entanglement_interfaces\":";
+        write_unsigned(node->n_interfaces());
+        _buffer += ",\"swap_probability\":";
+        write_double(node->swap_probability());
+        _buffer += ",\"time_slots\":";
+        if (node->time_slots().empty())
+            _buffer += "null";
+        else {
+            _buffer += '[';
+            for (std::size_t slot = 0; slot < node->time_slots().size(); ++slot) {
+                const std::vector<Swap>& swaps = node->time_slots()[slot].swap_instructions();
+                if (slot > 0)
+                    _buffer += ',';
+                if (swaps.empty()) {
+                    _buffer += "null";
+                    continue;
+                }
+                _buffer += '[';
+                for (std::size_t n = 0; n < swaps.size(); ++n) {
+                    SwapPair pair = swaps[n].swap_pair();
+                    if (n > 0)
+                        _buffer += ',';
+                    _buffer += '"';
+                    write_unsigned(pair.e1.lock()->n_interface());
+                    _buffer += '-';
+                    write_unsigned(pair.e2.lock()->n_interface());
+                    _buffer += '"';
+                }
+                _buffer += ']';
+            }
+            _buffer += ']';
+        }
+        _buffer += '}';
+    }
+    _buffer += "}}";
+    return _buffer;
+}
+
+// Leaves in _links the links of the document, in no particular order. to_json meets the link of every
+// interface in node order and skips one whose reverse key it already stored, so of the links between
+// two nodes it keeps the end met first, with the interfaces of the last link met from that end (the
+// first, for a node linked to itself, whose key is its reverse). Node names are unique, so the links
+// of a key are those between its two nodes: they are grouped by node pair, without building a key.
+void NetworkJsonWriter::collect_links(const Network& network) {
+    _links.clear();
+    for (const std::unique_ptr<Node>& node : network.nodes())
+        for (std::size_t i = 0; i < node->n_interfaces(); ++i) {
+            const EntanglementInterface* fibre = (*node)[i]->fibre_pair().lock().get();
+            _links.push_back(Link{node.get(), fibre->context(), i, fibre->n_interface(), _links.size()});
+        }
+
+    std::less<const Node*> before;
+    auto node_pair = [&before](const Link& link) {
+        return before(link.node2, link.node1)? std::make_pair(link.node2, link.node1) : std::make_pair(link.node1, link.node2);
+    };
+    std::sort(_links.begin(), _links.end(), [&](const Link& link1, const Link& link2) {
+        std::pair<const Node*, const Node*> pair1 = node_pair(link1), pair2 = node_pair(link2);
+        if (pair1 != pair2)
+            return before(pair1.first, pair2.first) || (pair1.first == pair2.first && before(pair1.second, pair2.second));
+        return link1.met < link2.met;
+    });
+    std::size_t n_kept = 0;
+    for (std::size_t first = 0, end; first < _links.size(); first = end) {
+        std::size_t kept = first;
+        for (end = first + 1; end < _links.size() && node_pair(_links[end]) == node_pair(_links[first]); ++end)
+            if (_links[end].node1 == _links[first].node1 && _links[first].node1 != _links[first].node2)
+                kept = end;
+        _links[n_kept++] = _links[kept];
+    }
+    _links.resize(n_kept);
+}
+
+// Escaped as nlohmann::json::dump() does without ensure_ascii
+void NetworkJsonWriter::write_string(const std::string& value) {
+    static const char hex_digits[] = "0123456789abcdef";
+    for (char c : value)
+        switch (c) {
+            case '"': _buffer += "\\\""; break;
+            case '\\': _buffer += "\\\\"; break;
+            case '\b': _buffer += "\\b"; break;
+            case '\f': _buffer += "\\f"; break;
+            case '\n': _buffer += "\\n"; break;
+            case '\r': _buffer += "\\r"; break;
+            case '\t': _buffer += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) <= 0x1f) {
+                    _buffer += "\\u00";
+                    _buffer += hex_digits[static_cast<unsigned char>(c) >> 4];
+                    _buffer += hex_digits[static_cast<unsigned char>(c) & 0xf];
+                } else
+                    _buffer += c;
+        }
+}
+
+void NetworkJsonWriter::write_unsigned(std::size_t value) {
+    std::array<char, 20> digits;
+    std::size_t n = 0;
+    do {
+        digits[n++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    while (n > 0)
+        _buffer += digits[--n];
+}
+
+// The shortest round-trip form nlohmann::json prints doubles in, null when not finite
+void NetworkJsonWriter::write_double(double value) {
+    if (!std::isfinite(value)) {
+        _buffer += "null";
+        return;
+    }
+    std::array<char, 64> digits;
+    char* end = nlohmann::detail::to_chars(digits.data(), digits.data() + digits.size(), value);
+    _buffer.append(digits.data(), end);
+}
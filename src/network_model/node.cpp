@@ -14,10 +14,50 @@ void Node::initialize_node(nlohmann::json node_config) {
         _swap_probability = node_config["swap_probability"].get<double>();
 }
 
+void Node::initialize_node(const Node& other) {
+    _entanglement_interfaces.reserve(other.n_interfaces());
+    for (std::size_t i = 0; i < other.n_interfaces(); ++i)
+        _entanglement_interfaces.push_back(
+            std::make_shared<EntanglementInterface>(EntanglementInterface(this, i))
+        );
+    _instruction_table.set_instruction_table(this, other._instruction_table);
+    _swap_probability = other._swap_probability;
+}
+
+void Node::initialize_node(std::size_t n_interfaces, double swap_probability) {
+    _entanglement_interfaces.reserve(n_interfaces);
+    for (std::size_t i = 0; i < n_interfaces; ++i)
+        _entanglement_interfaces.push_back(
+            std::make_shared<EntanglementInterface>(EntanglementInterface(this, i))
+        );
+    _instruction_table.set_instruction_table(this, InstructionTable());
+    _swap_probability = swap_probability;
+}
+
 void Node::reset_instruction_table(const std::vector<TimeSlot>& time_slots) {
     _instruction_table.reset(time_slots);
 }
 
+void Node::copy_instruction_table(const Node& other) {
+    if (other.n_interfaces() != n_interfaces())
+        throw "Instruction table copied between nodes with different interfaces";
+    std::vector<TimeSlot> time_slots;
+    time_slots.reserve(other.time_slots().size());
+    for (const TimeSlot& time_slot : other.time_slots())
+        time_slots.push_back(TimeSlot(this, time_slot));
+    _instruction_table.reset(time_slots);
+}
+
+void Node::copy_time_slot(std::size_t n, const Node& other, std::size_t other_n) {
+    if (other.n_interfaces() != n_interfaces())
+        throw "Time slot copied between nodes with different interfaces";
+    _instruction_table.replace_time_slot(n, other.time_slots()[other_n]);
+}
+
+void Node::canonicalize_instruction_table(std::size_t period, std::size_t rotation) {
+    _instruction_table.canonicalize(period, rotation);
+}
+
 void Node::compute_next_time_slot(std::uint32_t time_slot_duration_nanoseconds) {
     _instruction_table.execute_swaps_next_time_slot();
     _instruction_table.execute_stores_next_time_slot(time_slot_duration_nanoseconds);
@@ -25,10 +65,6 @@ void Node::compute_next_time_slot(std::uint32_t time_slot_duration_nanoseconds)
         interface->reset_entangled_pair();
 }
 
-void Node::mutate(const std::function<double(void)>& rnd01) {
-    _instruction_table.mutate(rnd01);
-}
-
 std::vector<std::shared_ptr<EntanglementInterface>> Node::get_interfaces() const {
     std::vector<std::shared_ptr<EntanglementInterface>> interface_references;
 
@@ -0,0 +1,193 @@
+#include "network_model/simulation_kernel.hpp"
+
+#include "network_model/entanglement_interface.hpp"
+#include "network_model/node.hpp"
+
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <unordered_map>
+
+RuntimeTopology::RuntimeTopology(const Network& network):
+    _time_slot_duration_nanoseconds(network.time_slots_duration_nanoseconds()),
+    _all_swap_probabilities_one(true) {
+
+    const std::vector<std::unique_ptr<Node>>& nodes = network.nodes();
+    std::unordered_map<const Node*, std::uint32_t> node_index;
+
+    _node_names.reserve(nodes.size());
+    _interface_offset.reserve(nodes.size() + 1);
+    _swap_probability.reserve(nodes.size());
+    _expected_swaps_per_nanosecond.reserve(nodes.size());
+    for (const std::unique_ptr<Node>& node : nodes) {
+        node_index[node.get()] = static_cast<std::uint32_t>(_node_names.size());
+        _node_names.push_back(node->_node_name);
+        _interface_offset.push_back(static_cast<std::uint32_t>(_interface_node.size()));
+        _swap_probability.push_back(node->swap_probability());
+        _expected_swaps_per_nanosecond.push_back(node->expected_swaps_per_nanosecond());
+        if (node->swap_probability() != 1.0)
+            _all_swap_probabilities_one = false;
+        for (std::size_t i = 0; i < node->n_interfaces(); ++i)
+            _interface_node.push_back(static_cast<std::uint32_t>(_node_names.size() - 1));
+    }
+    _interface_offset.push_back(static_cast<std::uint32_t>(_interface_node.size()));
+
+    _fibre.reserve(_interface_node.size());
+    for (const std::unique_ptr<Node>& node : nodes)
+        for (const std::shared_ptr<EntanglementInterface>& interface : node->get_interfaces()) {
+            std::shared_ptr<EntanglementInterface> fibre_pair = interface->fibre_pair().lock();
+            if (!fibre_pair)
+                throw "Entanglement interface without fibre pair";
+            _fibre.push_back(_interface_offset[node_index.at(fibre_pair->context())] + static_cast<std::uint32_t>(fibre_pair->n_interface()));
+        }
+
+    _pair_index.assign(nodes.size()*nodes.size(), no_pair);
+    for (const NodePair& pair : network.pairs()) {
+        std::uint32_t n1 = node_index.at(pair.n1), n2 = node_index.at(pair.n2);
+        std::uint32_t index = static_cast<std::uint32_t>(_pair_lambda.size());
+        _pair_index[n1*nodes.size() + n2] = index;
+        _pair_index[n2*nodes.size() + n1] = index;
+        _pair_fidelity_capacity.push_back(pair.entanglement_fidelity_capacity);
+        _pair_lambda.push_back(network.pair_weight(pair));
+    }
+}
+
+namespace {
+
+std::uint64_t double_bits(double value) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+template<typename T, typename Accessor>
+void write_array(std::ostream& os, const char* type, const char* name, std::size_t size, const char* size_name, Accessor&& accessor) {
+    os << "    static constexpr std::array<" << type << ", " << size_name << "> " << name << "{{";
+    for (std::size_t i = 0; i < size; ++i)
+        os << (i == 0? "" : ", ") << static_cast<T>(accessor(i));
+    os << "}};\n";
+}
+
+}
+
+Hash128 RuntimeTopology::hash() const {
+    Hasher128 hasher;
+    hasher.add(n_nodes()).add(n_interfaces()).add(n_pairs()).add(_time_slot_duration_nanoseconds);
+    for (std::size_t node = 0; node < n_nodes(); ++node) {
+        for (char c : _node_names[node])
+            hasher.add(static_cast<unsigned char>(c));
+        hasher.add(_interface_offset[node]).add(double_bits(_swap_probability[node])).add(_expected_swaps_per_nanosecond[node]);
+    }
+    for (std::size_t interface = 0; interface < n_interfaces(); ++interface)
+        hasher.add(_fibre[interface]);
+    for (std::size_t pair = 0; pair < n_pairs(); ++pair)
+        hasher.add(double_bits(_pair_fidelity_capacity[pair])).add(double_bits(_pair_lambda[pair].lambda)).add(double_bits(_pair_lambda[pair].max_for_lambda));
+    return hasher.finish();
+}
+
+void RuntimeTopology::write_static_topology_header(std::ostream& os, const std::string& source_name) const {
+    os << std::setprecision(std::numeric_limits<double>::max_digits10);
+    os << "// Generated by topology_codegen from " << source_name << ". Do not edit.\n"
+       << "#ifndef STATIC_TOPOLOGY_HPP\n"
+       << "#define STATIC_TOPOLOGY_HPP\n\n"
+       << "#include \"network_model/network.hpp\"\n\n"
+       << "#include <array>\n"
+       << "#include <cstdint>\n\n"
+       << "struct GeneratedTopology {\n"
+       << "    static constexpr std::size_t n_nodes = " << n_nodes() << ";\n"
+       << "    static constexpr std::size_t n_interfaces = " << n_interfaces() << ";\n"
+       << "    static constexpr std::size_t n_pairs = " << n_pairs() << ";\n"
+       << "    static constexpr std::uint32_t time_slot_duration_nanoseconds = " << _time_slot_duration_nanoseconds << ";\n"
+       << "    static constexpr bool all_swap_probabilities_one = " << (_all_swap_probabilities_one? "true" : "false") << ";\n\n";
+
+    os << "    static constexpr std::array<const char*, n_nodes> node_names{{";
+    for (std::size_t node = 0; node < n_nodes(); ++node)
+        os << (node == 0? "" : ", ") << std::quoted(_node_names[node]);
+    os << "}};\n";
+    write_array<std::uint32_t>(os, "std::uint32_t", "interface_offset", _interface_offset.size(), "n_nodes + 1",
+        [this](std::size_t i) { return _interface_offset[i]; });
+    write_array<double>(os, "double", "swap_probability", n_nodes(), "n_nodes",
+        [this](std::size_t i) { return _swap_probability[i]; });
+    write_array<std::uint32_t>(os, "std::uint32_t", "expected_swaps_per_nanosecond", n_nodes(), "n_nodes",
+        [this](std::size_t i) { return _expected_swaps_per_nanosecond[i]; });
+    write_array<std::uint32_t>(os, "std::uint32_t", "interface_node", n_interfaces(), "n_interfaces",
+        [this](std::size_t i) { return _interface_node[i]; });
+    write_array<std::uint32_t>(os, "std::uint32_t", "fibre", n_interfaces(), "n_interfaces",
+        [this](std::size_t i) { return _fibre[i]; });
+    write_array<std::uint32_t>(os, "std::uint32_t", "pair_index", _pair_index.size(), "n_nodes * n_nodes",
+        [this](std::size_t i) { return _pair_index[i]; });
+    write_array<double>(os, "double", "pair_fidelity_capacity", n_pairs(), "n_pairs",
+        [this](std::size_t i) { return _pair_fidelity_capacity[i]; });
+
+    os << "    static constexpr std::array<LambdaCfg, n_pairs> pair_lambda{{";
+    for (std::size_t pair = 0; pair < n_pairs(); ++pair)
+        os << (pair == 0? "" : ", ") << "LambdaCfg{" << _pair_lambda[pair].lambda << ", " << _pair_lambda[pair].max_for_lambda << "}";
+    os << "}};\n"
+       << "};\n\n"
+       << "#endif //STATIC_TOPOLOGY_HPP\n";
+}
+
+SimulationSchedule::SimulationSchedule(const Network& network, const RuntimeTopology& topology) {
+    const std::vector<std::unique_ptr<Node>>& nodes = network.nodes();
+
+    node_slot_begin.reserve(nodes.size() + 1);
+    for (std::size_t node = 0; node < nodes.size(); ++node) {
+        std::uint32_t offset = topology.interface_offset(node);
+        node_slot_begin.push_back(static_cast<std::uint32_t>(slots.size()));
+        for (const TimeSlot& time_slot : nodes[node]->time_slots()) {
+            Slot slot;
+            slot.swap_begin = static_cast<std::uint32_t>(swaps.size());
+            for (const Swap& swap : time_slot.swap_instructions()) {
+                swaps.push_back(offset + static_cast<std::uint32_t>(swap.swap_pair().e1.lock()->n_interface()));
+                swaps.push_back(offset + static_cast<std::uint32_t>(swap.swap_pair().e2.lock()->n_interface()));
+            }
+            slot.swap_end = static_cast<std::uint32_t>(swaps.size());
+            slot.store_begin = static_cast<std::uint32_t>(stores.size());
+            for (const Store& store : time_slot.store_instructions())
+                stores.push_back(offset + static_cast<std::uint32_t>(store.interface().lock()->n_interface()));
+            slot.store_end = static_cast<std::uint32_t>(stores.size());
+            slots.push_back(slot);
+        }
+    }
+    node_slot_begin.push_back(static_cast<std::uint32_t>(slots.size()));
+}
+
+void SimulationSchedule::encode(std::vector<std::uint32_t>& words) const {
+    words.clear();
+    words.reserve(4 + node_slot_begin.size() + 4*slots.size() + swaps.size() + stores.size());
+    words.push_back(static_cast<std::uint32_t>(node_slot_begin.size()));
+    words.push_back(static_cast<std::uint32_t>(slots.size()));
+    words.push_back(static_cast<std::uint32_t>(swaps.size()));
+    words.push_back(static_cast<std::uint32_t>(stores.size()));
+    words.insert(words.end(), node_slot_begin.begin(), node_slot_begin.end());
+    for (const Slot& slot : slots) {
+        words.push_back(slot.swap_begin);
+        words.push_back(slot.swap_end);
+        words.push_back(slot.store_begin);
+        words.push_back(slot.store_end);
+    }
+    words.insert(words.end(), swaps.begin(), swaps.end());
+    words.insert(words.end(), stores.begin(), stores.end());
+}
+
+SimulationSchedule::SimulationSchedule(const std::uint32_t* words, std::size_t n_words) {
+    if (n_words < 4)
+        throw "Truncated simulation schedule";
+    std::size_t n_node_entries = words[0], n_slots = words[1], n_swaps = words[2], n_stores = words[3];
+    if (n_words != 4 + n_node_entries + 4*n_slots + n_swaps + n_stores)
+        throw "Truncated simulation schedule";
+    const std::uint32_t* word = words + 4;
+    node_slot_begin.assign(word, word + n_node_entries);
+    word += n_node_entries;
+    slots.resize(n_slots);
+    for (Slot& slot : slots) {
+        slot.swap_begin = word[0];
+        slot.swap_end = word[1];
+        slot.store_begin = word[2];
+        slot.store_end = word[3];
+        word += 4;
+    }
+    swaps.assign(word, word + n_swaps);
+    word += n_swaps;
+    stores.assign(word, word + n_stores);
+}
@@ -0,0 +1,27 @@
+#include "network_model/network.hpp"
+#include "network_model/simulation_kernel.hpp"
+
+#include <fstream>
+#include <iostream>
+
+std::string network_topology_config_file;
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <topology.json> <static_topology.hpp>\n";
+        return 1;
+    }
+    network_topology_config_file = argv[1];
+
+    Network network(argv[1]);
+    RuntimeTopology topology(network);
+
+    std::ofstream header(argv[2]);
+    topology.write_static_topology_header(header, argv[1]);
+    if (!header) {
+        std::cerr << "Could not write " << argv[2] << "\n";
+        return 1;
+    }
+
+    return 0;
+}